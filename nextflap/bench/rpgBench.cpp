@@ -0,0 +1,123 @@
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Microbenchmark of the relaxed planning graphs. It    */
+/* evaluates a sequence of states of a problem with the */
+/* FF and the numeric RPG, which are used to compute    */
+/* the heuristic value of every plan.                   */
+/*                                                      */
+/* Usage: rpgBench domain problem [iterations]          */
+/*                                                      */
+/* Results (ms per 1000 evaluations, -O2, 100 states of */
+/* a temporal logistics problem with 20 locations, 5    */
+/* trucks and 20 packages):                             */
+/*                                 FF_RPG  NumericRPG   */
+/*   Pointer priority queue           486        1148   */
+/*   Value heap                       429        1122   */
+/*   Current (reusable graphs)        176         423   */
+/* The value heap alone saves the allocations of the    */
+/* queue items; most of the gain comes from reusing the */
+/* graphs between evaluations.                          */
+/********************************************************/
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include "../parser/parser.h"
+#include "../preprocess/preprocess.h"
+#include "../grounder/grounder.h"
+#include "../sas/sasTranslator.h"
+#include "../heuristics/hFF.h"
+#include "../heuristics/numericRPG.h"
+
+using namespace std;
+
+#define NUM_STATES	100
+
+// Checks if the SAS conditions of an action hold in a state (the numeric conditions are ignored)
+static bool isApplicable(SASAction& a, TState* s)
+{
+	for (SASCondition& c : a.startCond)
+		if (s->state[c.var] != c.value) return false;
+	for (SASCondition& c : a.overCond)
+		if (s->state[c.var] != c.value) return false;
+	for (SASCondition& c : a.endCond)
+		if (s->state[c.var] != c.value) return false;
+	return true;
+}
+
+// Builds a sequence of states applying random actions from the initial state, so consecutive states only
+// differ in a few values, as the frontier states of a plan and its children
+static void randomWalk(SASTask* task, vector<TState*>& states)
+{
+	mt19937 random(1);		// Fixed seed, so all the runs evaluate the same states
+	TState current(task);
+	vector<SASAction*> candidates;
+	while (states.size() < NUM_STATES) {
+		TState* s = new TState(current.numSASVars, current.numNumVars);
+		for (unsigned int i = 0; i < current.numSASVars; i++)
+			s->state[i] = current.state[i];
+		for (unsigned int i = 0; i < current.numNumVars; i++) {
+			s->minState[i] = current.minState[i];
+			s->maxState[i] = current.maxState[i];
+		}
+		states.push_back(s);
+		candidates.clear();
+		for (SASAction& a : task->actions)
+			if (isApplicable(a, &current)) candidates.push_back(&a);
+		if (candidates.empty()) break;
+		SASAction* a = candidates[random() % candidates.size()];
+		for (SASCondition& e : a->startEff)
+			current.state[e.var] = e.value;
+		for (SASCondition& e : a->endEff)
+			current.state[e.var] = e.value;
+	}
+}
+
+// Returns the time, in milliseconds, taken by the given number of calls to f
+template <typename F>
+static double measure(unsigned int iterations, F f)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (unsigned int i = 0; i < iterations; i++)
+		f();
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3) {
+		cout << "Usage: rpgBench domain problem [iterations]" << endl;
+		return 1;
+	}
+	unsigned int iterations = argc > 3 ? (unsigned int)atoi(argv[3]) : 1000;
+	Parser parser;
+	ParsedTask* parsedTask = parser.parseDomain(argv[1]);
+	parser.parseProblem(argv[2]);
+	Preprocess preprocess;
+	PreprocessedTask* prepTask = preprocess.preprocessTask(parsedTask);
+	Grounder grounder;
+	GroundedTask* gTask = grounder.groundTask(prepTask, false);
+	SASTranslator translator;
+	SASTask* task = translator.translate(gTask, false, false, false);
+	vector<SASAction*> tilActions;		// The timed initial literals are not included in the benchmark
+	vector<TState*> states;
+	randomWalk(task, states);
+	FF_RPG ffRPG(task, &tilActions);
+	NumericRPG numRPG(task, &tilActions);
+	unsigned int next = 0;
+	int h = 0;					// Sum of the heuristic values, to check that all the versions compute the same values
+	double ffTime = measure(iterations, [&]() { h += ffRPG.evaluate(states[next++ % states.size()]); });
+	cout << "FF_RPG: h=" << h << ", " << ffTime * 1000 / iterations << " ms per 1000 evaluations" << endl;
+	next = h = 0;
+	double numTime = measure(iterations, [&]() { h += numRPG.evaluate(states[next++ % states.size()], 100); });
+	cout << "NumericRPG: h=" << h << ", " << numTime * 1000 / iterations << " ms per 1000 evaluations" << endl;
+	for (TState* s : states)
+		delete s;
+	delete task;
+	delete gTask;
+	delete prepTask;
+	delete parsedTask;
+	return 0;
+}
@@ -1,7 +1,6 @@
 #include "evaluator.h"
 #include <time.h>
-#include "numericRPG.h"
-#include "hFF.h"
+#include <algorithm>
 using namespace std;
 
 /********************************************************/
@@ -17,15 +16,7 @@ using namespace std;
 
 // Evaluates a plan. Its heuristic value is stored in the plan (p->h)
 void Evaluator::evaluate(Plan* p) {
-	int limit = p->parentPlan->h;
-	if (numericConditionsOrConditionalEffects) {
-		NumericRPG rpg(p->fs, tilActions, task, limit);
-		p->h = rpg.evaluate();
-	}
-	else {
-		FF_RPG rpg(p->fs, tilActions, task);
-		p->h = rpg.evaluate();
-	}
+	p->h = evaluateState(p, p->parentPlan->h);
 	if (landmarks != nullptr)
 	p->hLand = landmarks->countUncheckedNodes();
 }
@@ -36,8 +27,42 @@ void Evaluator::evaluateInitialPlan(Plan* p)
 	int numActions = (int)task->actions.size(), limit = 100;
 	//usefulActions = new bool[numActions];
 	//for (int i = 0; i < numActions; i++) usefulActions[i] = false;
-	NumericRPG rpg(p->fs, tilActions, task, limit);
-	p->h = rpg.evaluateInitialPlan(/*usefulActions*/);
+	p->h = numRPG->evaluateInitialPlan(getFrontierState(p), limit/*, usefulActions*/);
+}
+
+// Computes the relaxed plan from the frontier state of a plan that has been already evaluated. It is
+// not recomputed if this state was the last one evaluated
+std::vector<SASAction*>* Evaluator::computeRelaxedPlan(Plan* p)
+{
+	if (p->stateId == relaxedPlanState)
+		return &relaxedPlan;
+	evaluateState(p, p->parentPlan != nullptr ? p->parentPlan->h : 100);
+	return &relaxedPlan;
+}
+
+// Computes the heuristic value and the relaxed plan of the frontier state of a plan, unless they are stored
+// in the cache. The numeric graph is expanded up to the given limit, so it is also part of the cache key
+int Evaluator::evaluateState(Plan* p, int limit)
+{
+	int h, key = numericConditionsOrConditionalEffects ? limit : 0;
+	HeuristicCacheEntry* e = cache.find(p->stateId, key);
+	if (e != nullptr) {
+		h = e->h;
+		relaxedPlan.assign(e->relaxedPlan.begin(), e->relaxedPlan.end());
+	}
+	else {
+		if (numericConditionsOrConditionalEffects) {
+			h = numRPG->evaluate(getFrontierState(p), limit);
+			relaxedPlan.swap(numRPG->relaxedPlan);
+		}
+		else {
+			h = ffRPG->evaluate(getFrontierState(p));
+			relaxedPlan.swap(ffRPG->relaxedPlan);
+		}
+		cache.add(p->stateId, key, h, relaxedPlan);
+	}
+	relaxedPlanState = p->stateId;
+	return h;
 }
 
 bool Evaluator::informativeLandmarks()
@@ -45,81 +70,178 @@ bool Evaluator::informativeLandmarks()
 	return landmarks != nullptr && landmarks->getNumInformativeNodes() > 0;
 }
 
-// Calculates the frontier state of a given plan. It also computes the number of useful actions included in the plan
-void Evaluator::calculateFrontierState(TState* fs, Plan* currentPlan)
+// Applies the effects of a timepoint to the frontier state and progresses the landmarks. The changes are logged
+void Evaluator::applyPoint(ScheduledPoint& sp)
 {
+	SASAction* a = sp.plan->action;
+	bool atStart = (sp.p & 1) == 0;
+	std::vector<SASCondition>* eff = atStart ? &a->startEff : &a->endEff;
+	for (SASCondition& c : *eff) {
+		changeValue(c.var, c.value);
+	}
+	for (int numCondEff : sp.plan->getConditionalEffects()) {
+		SASConditionalEffect& ce = a->conditionalEff[numCondEff];
+		eff = atStart ? &ce.startEff: &ce.endEff;
+		for (SASCondition &c : *eff) {
+			changeValue(c.var, c.value);
+		}
+	}
+	for (TFluentInterval& f : sp.plan->getNumVarValues(atStart)) {
+		changeNumericValue(f.numVar, f.interval.minValue, f.interval.maxValue);
+	}
 	if (landmarks != nullptr) {
-		landmarks->uncheckNodes();
-		landmarks->copyRootNodes(&openNodes);
-	}
-	std::unordered_set<int> visitedActions;
-	pq.clear();
-	for (unsigned int i = 1; i < planComponents.size(); i++) {
-		Plan* p = planComponents.get(i);
-		pq.add(new ScheduledPoint(stepToStartPoint(i), p->startPoint.updatedTime, p));
-		pq.add(new ScheduledPoint(stepToEndPoint(i), p->endPoint.updatedTime, p));
-		if (!p->action->isTIL && !p->action->isGoal) {
-			int index = p->action->index;
-			if (visitedActions.find(index) == visitedActions.end()) {
-				visitedActions.insert(index);
-				/*
-				if (usefulActions[index])
-					currentPlan->numUsefulActions++;*/
+		LandmarkCheck* l, * al;
+		unsigned int j = 0;
+		while (j < openNodes.size()) {
+			l = openNodes[j];
+			//cout << "Landmark " << l->toString(task, false) << endl;
+			if (l->goOn(frontierState)) {	// The landmark holds in the state and we can progress
+				l->check();
+				landmarkLog.push_back(l);
+				openNodes.erase(openNodes.begin() + j); // Remove node from the open nodes list
+				for (unsigned int k = 0; k < l->numNext(); k++) { // Go to the adjacent nodes
+					al = l->getNext(k);
+					if (!al->isChecked() && !findOpenNode(al)) {
+						openNodes.push_back(al); // Non-visited node -> append to open nodes
+					}
+				}
+			}
+			else {
+				j++;
 			}
 		}
 	}
-	LandmarkCheck* l, * al;
-	while (pq.size() > 0) {
-		ScheduledPoint* p = (ScheduledPoint*)pq.poll();
-		SASAction* a = p->plan->action;
-		bool atStart = (p->p & 1) == 0;
-		std::vector<SASCondition>* eff = atStart ? &a->startEff : &a->endEff;
-		std::vector<TFluentInterval>* numEff = atStart ? p->plan->startPoint.numVarValues : p->plan->endPoint.numVarValues;
-		for (SASCondition& c : *eff) {
-			fs->state[c.var] = c.value;
+	trace.push_back(sp);
+	traceLog.emplace_back((unsigned int)valueLog.size(), (unsigned int)numValueLog.size(), (unsigned int)landmarkLog.size());
+}
+
+// Undoes the last timepoints of the trace, so only the first ones (size) remain applied
+void Evaluator::undoTrace(unsigned int size)
+{
+	if (size == 0) {
+		frontierState->setInitialState(task);
+		frontierStateHash = initialStateHash;
+		valueLog.clear();
+		numValueLog.clear();
+		landmarkLog.clear();
+		if (landmarks != nullptr) {
+			landmarks->uncheckNodes();
+			landmarks->copyRootNodes(&openNodes);
 		}
-		if (p->plan->holdCondEff != nullptr) {
-			for (int numCondEff : *p->plan->holdCondEff) {
-				SASConditionalEffect& ce = a->conditionalEff[numCondEff];
-				eff = atStart ? &ce.startEff: &ce.endEff;
-				for (SASCondition &c : *eff) {
-					fs->state[c.var] = c.value;
-				}
-			}
+	}
+	else if (size < trace.size()) {
+		FrontierLogSize& logSize = traceLog[size - 1];
+		while (valueLog.size() > logSize.values) {
+			FrontierValue& v = valueLog.back();
+			setValue(frontierState, v.var, v.value);
+			valueLog.pop_back();
+		}
+		while (numValueLog.size() > logSize.numValues) {
+			FrontierNumValue& v = numValueLog.back();
+			setNumericValue(frontierState, v.var, v.minValue, v.maxValue);
+			numValueLog.pop_back();
 		}
-		delete p;
-		if (numEff != nullptr) {
-			for (TFluentInterval& f : *numEff) {
-				fs->minState[f.numVar] = f.interval.minValue;
-				fs->maxState[f.numVar] = f.interval.maxValue;
+		if (landmarks != nullptr && landmarkLog.size() > logSize.landmarks) {
+			while (landmarkLog.size() > logSize.landmarks) {
+				landmarkLog.back()->uncheck();
+				landmarkLog.pop_back();
 			}
+			rebuildOpenNodes();
 		}
-		if (landmarks != nullptr) {
-			int j = 0;
-			while (j < openNodes.size()) {
-				l = openNodes[j];
-				//cout << "Landmark " << l->toString(task, false) << endl;
-				if (l->goOn(fs)) {	// The landmark holds in the state and we can progress
-					l->check();
-					openNodes.erase(openNodes.begin() + j); // Remove node from the open nodes list
-					for (unsigned int k = 0; k < l->numNext(); k++) { // Go to the adjacent nodes
-						al = l->getNext(k);
-						if (!al->isChecked() && !findOpenNode(al)) {
-							openNodes.push_back(al); // Non-visited node -> append to open nodes
-						}
-					}
-				}
-				else {
-					j++;
+	}
+	trace.erase(trace.begin() + size, trace.end());
+	traceLog.erase(traceLog.begin() + size, traceLog.end());
+}
+
+// Computes the open landmarks from the checked ones: the unchecked roots and the unchecked successors
+// of the checked nodes
+void Evaluator::rebuildOpenNodes()
+{
+	landmarks->copyRootNodes(&openNodes);
+	unsigned int j = 0;
+	while (j < openNodes.size()) {
+		if (openNodes[j]->isChecked()) openNodes.erase(openNodes.begin() + j);
+		else j++;
+	}
+	for (LandmarkCheck* l : landmarkLog) {
+		for (unsigned int k = 0; k < l->numNext(); k++) {
+			LandmarkCheck* al = l->getNext(k);
+			if (!al->isChecked() && !findOpenNode(al))
+				openNodes.push_back(al);
+		}
+	}
+}
+
+// Calculates the frontier state of a plan from the initial state, applying the timepoints of all its steps
+void Evaluator::buildTrace(Plan* p)
+{
+	planComponents->calculate(p);
+	undoTrace(0);
+	points.clear();
+	for (unsigned int i = 1; i < planComponents->size(); i++) {
+		Plan* pc = planComponents->get(i);
+		points.emplace_back(stepToStartPoint(i), planComponents->getTime(stepToStartPoint(i)), pc);
+		points.emplace_back(stepToEndPoint(i), planComponents->getTime(stepToEndPoint(i)), pc);
+	}
+	std::sort(points.begin(), points.end());
+	for (ScheduledPoint& sp : points)
+		applyPoint(sp);
+	tracePlan = p;
+	tracePlanId = p->id;
+	traceVersion = planComponents->getTimesVersion(planComponents->size());
+	traceParent = nullptr;
+}
+
+// Calculates the frontier state of a plan from the frontier state of its parent (the current trace). Only
+// the timepoints from the first one that changes (the new step or a delayed step) are undone and reapplied
+void Evaluator::extendTrace(Plan* p)
+{
+	planComponents->calculate(p);
+	TStep newStep = planComponents->size() - 1;
+	ScheduledPoint start(stepToStartPoint(newStep), planComponents->getTime(stepToStartPoint(newStep)), p);
+	unsigned int fork = (unsigned int)(std::lower_bound(trace.begin(), trace.end(), start) - trace.begin());
+	if (p->planUpdates != nullptr) {
+		for (TPlanUpdate& u : *(p->planUpdates)) {
+			for (unsigned int i = 0; i < fork; i++) {
+				if (trace[i].p == u.timePoint) {
+					fork = i;
+					break;
 				}
 			}
+			ScheduledPoint delayed(u.timePoint, planComponents->getTime(u.timePoint), nullptr);
+			unsigned int pos = (unsigned int)(std::lower_bound(trace.begin(), trace.begin() + fork, delayed) - trace.begin());
+			if (pos < fork) fork = pos;
 		}
 	}
-	/*
-		for (int i = 0; i < fs->numSASVars; i++) {
-			cout << task->variables[i].name << "=" << task->values[fs->state[i]].name << endl;
-		}
-	*/
+	parentSuffix.assign(trace.begin() + fork, trace.end());
+	undoTrace(fork);
+	points.clear();
+	for (ScheduledPoint& sp : parentSuffix)
+		points.emplace_back(sp.p, planComponents->getTime(sp.p), sp.plan);
+	points.push_back(start);
+	points.emplace_back(stepToEndPoint(newStep), planComponents->getTime(stepToEndPoint(newStep)), p);
+	std::sort(points.begin(), points.end());
+	for (ScheduledPoint& sp : points)
+		applyPoint(sp);
+	traceParent = tracePlan;
+	traceParentId = tracePlanId;
+	traceParentVersion = traceVersion;
+	traceFork = fork;
+	tracePlan = p;
+	tracePlanId = p->id;
+	traceVersion = planComponents->getTimesVersion(planComponents->size());
+}
+
+// Restores the trace of the parent of the current trace plan
+void Evaluator::restoreParentTrace()
+{
+	undoTrace(traceFork);
+	for (ScheduledPoint& sp : parentSuffix)
+		applyPoint(sp);
+	tracePlan = traceParent;
+	tracePlanId = traceParentId;
+	traceVersion = traceParentVersion;
+	traceParent = nullptr;
 }
 
 bool Evaluator::findOpenNode(LandmarkCheck* l)
@@ -133,6 +255,19 @@ bool Evaluator::findOpenNode(LandmarkCheck* l)
 Evaluator::Evaluator()
 {
 	landmarks = nullptr;
+	ffRPG = nullptr;
+	numRPG = nullptr;
+	stateRegistry = nullptr;
+	frontierState = nullptr;
+	unpackedState = nullptr;
+	planComponents = nullptr;
+	frontierStateId = NO_STATE;
+	unpackedStateId = NO_STATE;
+	tracePlan = traceParent = nullptr;
+	tracePlanId = traceParentId = 0;
+	traceVersion = traceParentVersion = 0;
+	traceFork = 0;
+	relaxedPlanState = NO_STATE;
 }
 
 // Destroyer
@@ -140,11 +275,21 @@ Evaluator::~Evaluator()
 {
 	//delete[] usefulActions;
 	if (landmarks != nullptr) delete landmarks;
+	if (ffRPG != nullptr) delete ffRPG;
+	if (numRPG != nullptr) delete numRPG;
+	if (frontierState != nullptr) delete frontierState;
+	if (unpackedState != nullptr) delete unpackedState;
 }
 
 // Evaluator initialization
-void Evaluator::initialize(TState* state, SASTask* task, std::vector<SASAction*>* a, bool forceAtEndConditions) {
+void Evaluator::initialize(TState* state, SASTask* task, std::vector<SASAction*>* a, bool forceAtEndConditions,
+	StateRegistry* stateRegistry, PlanComponents* planComponents) {
 	this->task = task;
+	this->stateRegistry = stateRegistry;
+	this->planComponents = planComponents;
+	frontierState = new TState(task);
+	unpackedState = new TState(task);
+	initialStateHash = stateRegistry->getHash(frontierState);
 	numericConditionsOrConditionalEffects = false;
 	for (SASAction& a : task->actions) {
 		if (a.startNumCond.size() > 0 || a.overNumCond.size() > 0 || a.endNumCond.size() > 0) {
@@ -157,6 +302,9 @@ void Evaluator::initialize(TState* state, SASTask* task, std::vector<SASAction*>
 		}
 	}
 	tilActions = a;
+	if (!numericConditionsOrConditionalEffects)
+		ffRPG = new FF_RPG(task, a);
+	numRPG = new NumericRPG(task, a);
 	landmarks = new LandmarkHeuristic();
 	if (state == nullptr) landmarks->initialize(task, a);
 	else landmarks->initialize(state, task, a);
@@ -164,18 +312,38 @@ void Evaluator::initialize(TState* state, SASTask* task, std::vector<SASAction*>
 	if (landmarks->getNumInformativeNodes() <= 0) {
 		delete landmarks;
 		landmarks = nullptr;
-		SIGNIFICATIVE_LANDMARKS = false;
-	}
-	else {
-		SIGNIFICATIVE_LANDMARKS = true;
 	}
 }
 
-// Calculates the frontier state of a given plan. This state is stored in the plan (p->fs)
+// Calculates the frontier state of a given plan. This state is stored in the registry (p->stateId). The frontier
+// state of the parent plan is reused if it was the last one calculated (or its trace can be restored), and
+// none of its steps has been rescheduled since then
 void Evaluator::calculateFrontierState(Plan* p)
 {
 	//p->numUsefulActions = 0;
-	planComponents.calculate(p);
-	p->fs = new TState(task);			// Make a copy of the initial state
-	calculateFrontierState(p->fs, p);
+	Plan* parent = p->parentPlan;
+	if (parent == nullptr) buildTrace(p);
+	else {
+		planComponents->calculate(p);
+		unsigned int parentVersion = planComponents->getTimesVersion(planComponents->size() - 1);
+		if (!isTracePlan(parent, parentVersion)) {
+			if (traceParent == parent && traceParentId == parent->id && traceParentVersion == parentVersion)
+				restoreParentTrace();
+			else buildTrace(parent);
+		}
+		extendTrace(p);
+	}
+	p->stateId = frontierStateId = stateRegistry->insert(frontierState, frontierStateHash);
+}
+
+// Returns the frontier state of the plan, unpacking it from the registry if it is not the last one calculated
+TState* Evaluator::getFrontierState(Plan* p)
+{
+	if (p->stateId == frontierStateId)
+		return frontierState;
+	if (p->stateId != unpackedStateId) {
+		stateRegistry->unpack(p->stateId, unpackedState);
+		unpackedStateId = p->stateId;
+	}
+	return unpackedState;
 }
@@ -17,12 +17,16 @@
 #include "../sas/sasTask.h"
 #include "../planner/plan.h"
 #include "../planner/state.h"
+#include "../planner/stateRegistry.h"
 #include "../planner/linearizer.h"
 #include "../planner/planComponents.h"
 #include "hLand.h"
+#include "hFF.h"
+#include "numericRPG.h"
+#include "heuristicCache.h"
 
-// Entry of a priority queue to sort the plan timepoints
-class ScheduledPoint : public PriorityQueueItem {
+// Plan timepoint applied to the frontier state. Timepoints are applied by time (ties are broken by timepoint)
+class ScheduledPoint {
 public:
 	TTimePoint p;
 	float time;
@@ -33,38 +37,122 @@ public:
 		time = t;
 		plan = pl;
 	}
-	virtual inline int compare(PriorityQueueItem* other) {
-		double otherTime = ((ScheduledPoint*)other)->time;
-		if (time < otherTime) return -1;
-		else if (time > otherTime) return 1;
-		else return 0;
+	inline bool operator<(const ScheduledPoint& other) const {
+		return time < other.time || (time == other.time && p < other.p);
 	}
 };
 
+// Previous value of a variable modified in the frontier state
+class FrontierValue {
+public:
+	TVariable var;
+	TValue value;
+	FrontierValue(TVariable v, TValue value) { var = v; this->value = value; }
+};
+
+// Previous value of a numeric variable modified in the frontier state
+class FrontierNumValue {
+public:
+	TVariable var;
+	TFloatValue minValue;
+	TFloatValue maxValue;
+	FrontierNumValue(TVariable v, TFloatValue min, TFloatValue max) { var = v; minValue = min; maxValue = max; }
+};
+
+// Size of the frontier logs after applying a timepoint
+class FrontierLogSize {
+public:
+	unsigned int values;
+	unsigned int numValues;
+	unsigned int landmarks;
+	FrontierLogSize(unsigned int v, unsigned int n, unsigned int l) { values = v; numValues = n; landmarks = l; }
+};
+
 // Heuristic evaluator
 class Evaluator {
 private:
 	SASTask* task;
 	std::vector<SASAction*>* tilActions;
-	PlanComponents planComponents;
-	PriorityQueue pq;
+	PlanComponents* planComponents;						// Shared with the successors calculator
 	//bool* usefulActions;
 	LandmarkHeuristic* landmarks;
+	FF_RPG* ffRPG;										// Relaxed planning graph, reused in all the evaluations
+	NumericRPG* numRPG;									// Numeric relaxed planning graph, reused in all the evaluations
 	std::vector<LandmarkCheck*> openNodes;				// For hLand calculation
 	bool numericConditionsOrConditionalEffects;
+	StateRegistry* stateRegistry;
+	TState* frontierState;								// Frontier state of the last plan calculated
+	TStateId frontierStateId;
+	TState* unpackedState;								// Frontier state of other plan, taken from the registry
+	TStateId unpackedStateId;
+	std::vector<ScheduledPoint> trace;					// Timepoints applied to obtain the frontier state, in order
+	std::vector<FrontierLogSize> traceLog;				// Size of the logs after applying each timepoint of the trace
+	std::vector<FrontierValue> valueLog;				// Changes in the frontier state, to undo the last timepoints
+	std::vector<FrontierNumValue> numValueLog;
+	std::vector<LandmarkCheck*> landmarkLog;			// Landmarks checked, in order
+	std::vector<ScheduledPoint> points;					// For internal calculations
+	Plan* tracePlan;									// Plan whose frontier state is calculated
+	TPlanId tracePlanId;
+	unsigned int traceVersion;							// Times version of the components used to build the trace
+	Plan* traceParent;									// Parent of tracePlan, if its trace can be restored
+	TPlanId traceParentId;
+	unsigned int traceParentVersion;
+	unsigned int traceFork;								// Timepoints shared with the trace of the parent
+	std::vector<ScheduledPoint> parentSuffix;			// Remaining timepoints of the parent trace
+	uint64_t frontierStateHash;							// Zobrist hash code of the frontier state, updated with each effect
+	uint64_t initialStateHash;
+	std::vector<SASAction*> relaxedPlan;				// Relaxed plan of the last state evaluated
+	TStateId relaxedPlanState;
+	HeuristicCache cache;								// Evaluations of the last frontier states
 
-	void calculateFrontierState(TState* fs, Plan* currentPlan);
+	void buildTrace(Plan* p);
+	void extendTrace(Plan* p);
+	void restoreParentTrace();
+	void undoTrace(unsigned int size);
+	void applyPoint(ScheduledPoint& sp);
+	void rebuildOpenNodes();
+	inline bool isTracePlan(Plan* p, unsigned int version) {
+		return tracePlan == p && tracePlanId == p->id && traceVersion == version;
+	}
+	inline void changeValue(TVariable var, TValue value) {
+		if (frontierState->state[var] != value) {
+			valueLog.emplace_back(var, frontierState->state[var]);
+			setValue(frontierState, var, value);
+		}
+	}
+	inline void changeNumericValue(TVariable var, TFloatValue min, TFloatValue max) {
+		numValueLog.emplace_back(var, frontierState->minState[var], frontierState->maxState[var]);
+		setNumericValue(frontierState, var, min, max);
+	}
 	bool findOpenNode(LandmarkCheck* l);
+	int evaluateState(Plan* p, int limit);
+	TState* getFrontierState(Plan* p);
+	inline void setValue(TState* fs, unsigned int var, TValue value) {
+		if (fs->state[var] != value) {
+			frontierStateHash ^= stateRegistry->getValueKey(var, fs->state[var]) ^ stateRegistry->getValueKey(var, value);
+			fs->state[var] = value;
+		}
+	}
+	inline void setNumericValue(TState* fs, TVariable var, TFloatValue min, TFloatValue max) {
+		frontierStateHash ^= stateRegistry->getNumericKey(var, fs->minState[var], fs->maxState[var]) ^
+			stateRegistry->getNumericKey(var, min, max);
+		fs->minState[var] = min;
+		fs->maxState[var] = max;
+	}
 
 public:
 	Evaluator();
 	~Evaluator();
-	void initialize(TState* state, SASTask* task, std::vector<SASAction*>* a, bool forceAtEndConditions);
+	void initialize(TState* state, SASTask* task, std::vector<SASAction*>* a, bool forceAtEndConditions,
+		StateRegistry* stateRegistry, PlanComponents* planComponents);
 	void calculateFrontierState(Plan* p);
 	void evaluate(Plan* p);
 	void evaluateInitialPlan(Plan* p);
+	std::vector<SASAction*>* computeRelaxedPlan(Plan* p);
 	std::vector<SASAction*>* getTILActions() { return tilActions; }
 	bool informativeLandmarks();
+	inline uint64_t getCacheHits() { return cache.getHits(); }
+	inline uint64_t getCacheMisses() { return cache.getMisses(); }
 };
 
 #endif
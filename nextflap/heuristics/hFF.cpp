@@ -17,102 +17,108 @@ FF_RPGVarValue::FF_RPGVarValue(TVariable var, TValue value) {
 	this->value = value;
 }
 
-FF_RPG::FF_RPG(TState* fs, std::vector<SASAction*>* tilActions, SASTask* task) {
+// Constructor. Only the start and over all conditions of the actions are considered
+FF_RPG::FF_RPG(SASTask* task, std::vector<SASAction*>* tilActions) : counters(task, tilActions, false),
+	openConditions(128) {
 	this->task = task;
-	initialize();
+	this->tilActions = tilActions;
+	unsigned int numLiterals = counters.getNumLiterals();
+	literalLevels.resize(numLiterals);
+	literalEpoch.resize(numLiterals, 0);
+	actionLevels.resize(task->actions.size());
+	actionEpoch.resize(task->actions.size(), 0);
+	epoch = 0;
+	numLevels = 0;
+	maxChanges = (unsigned int)task->variables.size() / 8 + 1;
+	tilLiteral.resize(numLiterals, false);
+	if (tilActions != nullptr) {
+		for (SASAction* a : *tilActions)
+			for (SASCondition& c : a->endEff)
+				tilLiteral[literal(c.var, c.value)] = true;
+	}
+	affectedLiteral.resize(numLiterals, false);
+	affectedAction.resize(task->actions.size(), false);
+#ifdef CHECK_RPG_REPAIR
+	rebuiltRPG = nullptr;
+#endif
+}
+
+// Resets the graph (in constant time, by changing the epoch) and adds the values of the state at level 0
+void FF_RPG::initialize(TState* fs) {
+	if (++epoch == 0) {		// Overflow: the stamps of the previous epochs must be removed
+		fill(literalEpoch.begin(), literalEpoch.end(), 0);
+		fill(actionEpoch.begin(), actionEpoch.end(), 0);
+		epoch = 1;
+	}
+	counters.reset();
+	lastLevel.clear();
+	reachedValues.clear();
+	relaxedPlan.clear();
+	graphState.assign(fs->state, fs->state + fs->numSASVars);
 	//cout << "STATE:" << endl;
 	for (unsigned int i = 0; i < fs->numSASVars; i++) {
 		TValue v = fs->state[i];
-		lastLevel->emplace_back(i, v);
-		literalLevels[i][v] = 0;
+		lastLevel.emplace_back(i, v);
+		setLevel(literal(i, v), 0);
 		//cout << "(" << task->variables[i].name << ", " << task->values[v].name << ") -> Level 0" << endl;
 	}
 	if (tilActions != nullptr) {
-		addTILactions(tilActions);
+		addTILactions();
 	}
-	expand();
 }
 
-void FF_RPG::addTILactions(std::vector<SASAction*>* tilActions) {
+void FF_RPG::addTILactions() {
 	for (unsigned int i = 0; i < tilActions->size(); i++) {
 		SASAction* a = tilActions->at(i);
 		for (unsigned int j = 0; j < a->endEff.size(); j++) {
 			TVariable v = a->endEff[j].var;
 			TValue value = a->endEff[j].value;
-			if (literalLevels[v][value] != 0) {
-				lastLevel->emplace_back(v, value);
-				literalLevels[v][value] = 0;
+			unsigned int l = literal(v, value);
+			if (getLevel(l) != 0) {
+				lastLevel.emplace_back(v, value);
+				setLevel(l, 0);
 			}
 		}
 	}
 }
 
+// The values reached in a level are stamped with the next level as soon as they are added, so actions
+// only become executable in the following level
 void FF_RPG::expand() {
 	numLevels = 0;
-	while (lastLevel->size() > 0) {
-		newLevel->clear();
-		for (unsigned int i = 0; i < lastLevel->size(); i++) {
-			TVariable var = (*lastLevel)[i].var;
-			TValue value = (*lastLevel)[i].value;
+	while (lastLevel.size() > 0) {
+		newLevel.clear();
+		executable.clear();
+		for (unsigned int i = 0; i < lastLevel.size(); i++) {
 #ifdef DEBUG_RPG_ON
-			cout << "(" << task->variables[var].name << "," << task->values[value].name << ")" << endl;
+			cout << "(" << task->variables[lastLevel[i].var].name << "," << task->values[lastLevel[i].value].name << ")" << endl;
 #endif
-			vector<SASAction*> &actions = task->requirers[var][value];
-#ifdef DEBUG_RPG_ON
-			cout << actions.size() << " actions" << endl;
-#endif
-			for (unsigned int j = 0; j < actions.size(); j++) {
-				SASAction* a = actions[j];
-				if (actionLevels[a->index] == MAX_INT32 && isExecutable(a)) {
+			counters.reach(literal(lastLevel[i].var, lastLevel[i].value), &executable);
+		}
+		for (SASAction* a : executable) {
+			if (getActionLevel(a) == MAX_INT32) {
 #ifdef DEBUG_RPG_ON
-					cout << "[" << numLevels << "] " << a->name << endl;
+				cout << "[" << numLevels << "] " << a->name << endl;
 #endif
-					actionLevels[a->index] = numLevels;
-					addEffects(a);
-				}
+				setActionLevel(a, numLevels);
+				addEffects(a);
 			}
 		}
 		if (numLevels == 0) {
 			for (unsigned int j = 0; j < task->actionsWithoutConditions.size(); j++) {
 				SASAction* a = task->actionsWithoutConditions[j];
-				actionLevels[a->index] = numLevels;
+				setActionLevel(a, numLevels);
 				addEffects(a);
 			}
 		}
 		numLevels++;
-		for (unsigned int i = 0; i < newLevel->size(); i++) {
-			literalLevels[(*newLevel)[i].var][(*newLevel)[i].value] = numLevels;
-		}
-		vector<FF_RPGVarValue>* aux = lastLevel;
-		lastLevel = newLevel;
-		newLevel = aux;
+		lastLevel.swap(newLevel);
 	}
-	delete lastLevel;
-	delete newLevel;
 #ifdef DEBUG_RPG_ON
 	cout << "There are " << numLevels << " levels" << endl;
 #endif
 }
 
-bool FF_RPG::isExecutable(SASAction* a) {
-	for (unsigned int i = 0; i < a->startCond.size(); i++) {
-		if (literalLevels[a->startCond[i].var][a->startCond[i].value] == MAX_INT32)
-			return false;
-	}
-	for (unsigned int i = 0; i < a->overCond.size(); i++) {
-		if (literalLevels[a->overCond[i].var][a->overCond[i].value] == MAX_INT32)
-			return false;
-	}
-	/*
-	if (forceAtEndConditions) {
-		for (unsigned int i = 0; i < a->endCond.size(); i++) {
-			if (literalLevels[a->endCond[i].var][a->endCond[i].value] == MAX_INT32)
-				return false;
-		}
-	}*/
-	return true;
-}
-
 void FF_RPG::addEffects(SASAction* a) {
 	for (unsigned int i = 0; i < a->startEff.size(); i++) {
 		addEffect(a->startEff[i].var, a->startEff[i].value);
@@ -123,57 +129,43 @@ void FF_RPG::addEffects(SASAction* a) {
 }
 
 void FF_RPG::addEffect(TVariable var, TValue value) {
-	if (literalLevels[var][value] == MAX_INT32) {
-		for (unsigned int i = 0; i < newLevel->size(); i++)
-			if ((*newLevel)[i].var == var && (*newLevel)[i].value == value)
-				return;
-		newLevel->emplace_back(var, value);
+	unsigned int l = literal(var, value);
+	if (getLevel(l) == MAX_INT32) {
+		setLevel(l, numLevels + 1);
+		newLevel.emplace_back(var, value);
 #ifdef DEBUG_RPG_ON
 		cout << "* " << task->variables[var].name << " = " << task->values[value].name << endl;
 #endif
 	}
 }
 
-void FF_RPG::initialize() {
-	unsigned int numVars = task->variables.size();
-	literalLevels.resize(numVars);
-	for (unsigned int i = 0; i < numVars; i++) {
-		literalLevels[i].resize(task->values.size(), MAX_INT32);
-	}
-	actionLevels.resize(task->actions.size(), MAX_INT32);
-	lastLevel = new vector<FF_RPGVarValue>();
-	newLevel = new vector<FF_RPGVarValue>();
-}
-
 void FF_RPG::resetReachedValues() {
 	for (unsigned int i = 0; i < reachedValues.size(); i++) {
-		TVariable v = SASTask::getVariableIndex(reachedValues[i]);
-		TValue value = SASTask::getValueIndex(reachedValues[i]);
-		if (literalLevels[v][value] < 0)
-			literalLevels[v][value] = -literalLevels[v][value];
+		unsigned int l = reachedValues[i];
+		if (literalLevels[l] < 0)
+			literalLevels[l] = -literalLevels[l];
 	}
 	reachedValues.clear();
 }
 
-uint16_t FF_RPG::computeHeuristic(PriorityQueue* openConditions) {
+uint16_t FF_RPG::computeHeuristic() {
 	int gLevel;
 	uint16_t bestCost;
 	uint16_t h = 0;
-	while (openConditions->size() > 0) {
-		FF_RPGCondition* g = (FF_RPGCondition*)openConditions->poll();
-		//if (debug) cout << "Condition: " << task->variables[g->var].name << " = " << task->values[g->value].name << " (level " << literalLevels[g->var][g->value] << ")" << endl;
+	while (openConditions.size() > 0) {
+		FF_RPGCondition g = openConditions.poll();
+		unsigned int l = literal(g.var, g.value);
+		gLevel = getLevel(l);
 #ifdef DEBUG_RPG_ON
-		cout << "Condition: " << task->variables[g->var].name << " = " << task->values[g->value].name << " (level " << literalLevels[g->var][g->value] << ")" << endl;
+		cout << "Condition: " << task->variables[g.var].name << " = " << task->values[g.value].name << " (level " << gLevel << ")" << endl;
 #endif
-		gLevel = literalLevels[g->var][g->value];
 		if (gLevel <= 0) {
-			delete g;
 			continue;
 		}
 		if (gLevel == MAX_INT32) return MAX_UINT16;
-		literalLevels[g->var][g->value] = -gLevel;
-		reachedValues.push_back(SASTask::getVariableValueCode(g->var, g->value));
-		vector<SASAction*> &prod = task->producers[g->var][g->value];
+		literalLevels[l] = -gLevel;
+		reachedValues.push_back(l);
+		vector<SASAction*> &prod = task->producers[g.var][g.value];
 		SASAction* bestAction = nullptr;
 		bestCost = MAX_UINT16;
 		for (unsigned int i = 0; i < prod.size(); i++) {
@@ -181,7 +173,7 @@ uint16_t FF_RPG::computeHeuristic(PriorityQueue* openConditions) {
 #ifdef DEBUG_RPG_ON
 			cout << a->name << ", dif. " << getDifficulty(a) << endl;
 #endif			
-			if (gLevel == actionLevels[a->index] + 1) {
+			if (gLevel == getActionLevel(a) + 1) {
 				if (bestAction == nullptr) {
 					bestAction = a;
 					bestCost = /*mutex ? getDifficultyWithPermanentMutex(a) :*/ getDifficulty(a);
@@ -199,14 +191,13 @@ uint16_t FF_RPG::computeHeuristic(PriorityQueue* openConditions) {
 				}
 			}
 		}
-		delete g;
 		if (bestAction != nullptr) {
-			//if (debug) cout << bestAction->name << endl;
 #ifdef DEBUG_RPG_ON
 			cout << "* Best action = " << bestAction->name << ", cost " << bestCost << endl;
 #endif
 			h++;
-			addSubgoals(bestAction, openConditions);
+			relaxedPlan.push_back(bestAction);
+			addSubgoals(bestAction);
 		}
 		else {
 #ifdef DEBUG_RPG_ON
@@ -221,46 +212,202 @@ uint16_t FF_RPG::computeHeuristic(PriorityQueue* openConditions) {
 	return h;
 }
 
-uint16_t FF_RPG::evaluate() {
+// Repairs the graph of the previous state to obtain the graph of the given one. Returns false (and the
+// graph is not modified) if there are too many changes, so it is better to build it again
+bool FF_RPG::repair(TState* fs) {
+	if (graphState.size() != fs->numSASVars) return false;
+	changedVars.clear();
+	for (TVariable i = 0; i < fs->numSASVars; i++) {
+		if (fs->state[i] != graphState[i]) {
+			if (changedVars.size() == maxChanges) return false;
+			changedVars.push_back(i);
+		}
+	}
 	resetReachedValues();
-	PriorityQueue openConditions(128);
-	addSubgoals(task->getListOfGoals(), &openConditions);
-	return computeHeuristic(&openConditions);
+	relaxedPlan.clear();
+	repairQueue.clear();
+	for (TVariable var : changedVars) {		// Removed values (unless a TIL also reaches them)
+		if (!tilLiteral[literal(var, graphState[var])])
+			repairQueue.emplace(var, graphState[var], 0);
+	}
+	findAffected();
+	for (FF_RPGVarValue& v : affectedLiterals)
+		setLevel(literal(v.var, v.value), MAX_INT32);
+	for (SASAction* a : affectedActions)
+		setActionLevel(a, MAX_INT32);
+	for (TVariable var : changedVars) {		// Added values
+		TValue value = fs->state[var];
+		graphState[var] = value;
+		unsigned int l = literal(var, value);
+		if (getLevel(l) != 0) {
+			setLevel(l, 0);
+			repairQueue.emplace(var, value, 0);
+		}
+	}
+	for (SASAction* a : affectedActions) {
+		int level = computeActionLevel(a);
+		if (level != MAX_INT32) {
+			setActionLevel(a, level);
+			relaxEffects(a, level);
+		}
+		affectedAction[a->index] = false;
+	}
+	for (FF_RPGVarValue& v : affectedLiterals) {
+		unsigned int l = literal(v.var, v.value);
+		for (SASAction* a : task->producers[v.var][v.value]) {
+			int level = getActionLevel(a);
+			if (level != MAX_INT32 && level + 1 < getLevel(l)) setLevel(l, level + 1);
+		}
+		if (getLevel(l) != MAX_INT32) repairQueue.emplace(v.var, v.value, getLevel(l));
+		affectedLiteral[l] = false;
+	}
+	while (repairQueue.size() > 0) {		// Propagation of the lower levels
+		FF_RPGCondition c = repairQueue.poll();
+		if (getLevel(literal(c.var, c.value)) != c.level) continue;		// Already reached at a lower level
+		for (SASAction* a : task->requirers[c.var][c.value]) {
+			int level = computeActionLevel(a);
+			if (level < getActionLevel(a)) {
+				setActionLevel(a, level);
+				relaxEffects(a, level);
+			}
+		}
+	}
+	affectedLiterals.clear();
+	affectedActions.clear();
+	return true;
+}
+
+// Finds the values and actions whose level can increase, starting from the removed values in the queue.
+// The values are processed by increasing level, so the level of an unaffected producer is already final
+void FF_RPG::findAffected() {
+	while (repairQueue.size() > 0) {
+		FF_RPGCondition c = repairQueue.poll();
+		unsigned int l = literal(c.var, c.value);
+		if (affectedLiteral[l] || (c.level > 0 && isSupported(c))) continue;
+		affectedLiteral[l] = true;
+		affectedLiterals.emplace_back(c.var, c.value);
+		for (SASAction* a : task->requirers[c.var][c.value]) {
+			int level = getActionLevel(a);
+			if (affectedAction[a->index] || level == MAX_INT32) continue;
+			// The level of an action is the maximum of its start and over all conditions or, if it has none,
+			// the minimum of the other ones
+			if (a->startCond.empty() && a->overCond.empty() && (a->endCond.empty() || level != c.level)) continue;
+			affectedAction[a->index] = true;
+			affectedActions.push_back(a);
+			for (SASCondition& e : a->startEff)
+				if (getLevel(literal(e.var, e.value)) == level + 1) repairQueue.emplace(e.var, e.value, level + 1);
+			for (SASCondition& e : a->endEff)
+				if (getLevel(literal(e.var, e.value)) == level + 1) repairQueue.emplace(e.var, e.value, level + 1);
+		}
+	}
+}
+
+// Checks if a value keeps its level through a producer whose level does not change
+bool FF_RPG::isSupported(FF_RPGCondition& c) {
+	for (SASAction* a : task->producers[c.var][c.value]) {
+		if (!affectedAction[a->index] && getActionLevel(a) == c.level - 1)
+			return true;
+	}
+	return false;
+}
+
+// Computes the level of an action from the current levels of its conditions (as in FF_RPG::expand)
+int FF_RPG::computeActionLevel(SASAction* a) {
+	int level = 0;
+	if (!a->startCond.empty() || !a->overCond.empty()) {
+		for (SASCondition& c : a->startCond) level = max(level, getLevel(literal(c.var, c.value)));
+		for (SASCondition& c : a->overCond) level = max(level, getLevel(literal(c.var, c.value)));
+	}
+	else if (!a->endCond.empty()) {
+		level = MAX_INT32;
+		for (SASCondition& c : a->endCond) level = min(level, getLevel(literal(c.var, c.value)));
+		for (SASConditionalEffect& e : a->conditionalEff) {
+			for (SASCondition& c : e.startCond) level = min(level, getLevel(literal(c.var, c.value)));
+			for (SASCondition& c : e.endCond) level = min(level, getLevel(literal(c.var, c.value)));
+		}
+	}
+	return level;
+}
+
+// Lowers the level of the effects of an action reached at the given level
+void FF_RPG::relaxEffects(SASAction* a, int level) {
+	for (SASCondition& e : a->startEff) {
+		unsigned int l = literal(e.var, e.value);
+		if (level + 1 < getLevel(l)) {
+			setLevel(l, level + 1);
+			repairQueue.emplace(e.var, e.value, level + 1);
+		}
+	}
+	for (SASCondition& e : a->endEff) {
+		unsigned int l = literal(e.var, e.value);
+		if (level + 1 < getLevel(l)) {
+			setLevel(l, level + 1);
+			repairQueue.emplace(e.var, e.value, level + 1);
+		}
+	}
 }
 
-void FF_RPG::addSubgoals(std::vector<TVarValue>* goals, PriorityQueue* openConditions) {
+// Builds (or repairs) the graph for the given state and computes its heuristic value. The relaxed plan is also obtained
+uint16_t FF_RPG::evaluate(TState* fs) {
+	bool repaired = repair(fs);
+	if (!repaired) {
+		initialize(fs);
+		expand();
+		resetReachedValues();
+	}
+	openConditions.clear();
+	addSubgoals(task->getListOfGoals());
+	uint16_t h = computeHeuristic();
+#ifdef CHECK_RPG_REPAIR
+	if (repaired) checkRepair(fs, h);
+#endif
+	return h;
+}
+
+#ifdef CHECK_RPG_REPAIR
+// Debug self-check: the repaired graph must give the same heuristic value and relaxed plan as a full rebuild
+void FF_RPG::checkRepair(TState* fs, uint16_t h) {
+	if (rebuiltRPG == nullptr) rebuiltRPG = new FF_RPG(task, tilActions);
+	rebuiltRPG->graphState.clear();		// So it is not repaired
+	uint16_t rebuiltH = rebuiltRPG->evaluate(fs);
+	if (h != rebuiltH || relaxedPlan != rebuiltRPG->relaxedPlan)
+		throwError("Repaired RPG differs from the rebuilt one: h = " + to_string(h) + ", expected " + to_string(rebuiltH));
+}
+#endif
+
+void FF_RPG::addSubgoals(std::vector<TVarValue>* goals) {
 	TVariable var;
 	TValue value;
 	for (unsigned int i = 0; i < goals->size(); i++) {
 		var = SASTask::getVariableIndex(goals->at(i));
 		value = SASTask::getValueIndex(goals->at(i));
-		addSubgoal(var, value, openConditions);
+		addSubgoal(var, value);
 	}
 }
 
-void FF_RPG::addSubgoal(TVariable var, TValue value, PriorityQueue* openConditions) {
-	int level = literalLevels[var][value];
+void FF_RPG::addSubgoal(TVariable var, TValue value) {
+	int level = getLevel(literal(var, value));
 	if (level > 0) {
-		openConditions->add(new FF_RPGCondition(var, value, level));
+		openConditions.emplace(var, value, level);
 #ifdef DEBUG_RPG_ON
 		cout << "* Adding subgoal: " << task->variables[var].name << " = " << task->values[value].name << " (level " << level << ")" << endl;
 #endif
 	}
 }
 
-void FF_RPG::addSubgoals(SASAction* a, PriorityQueue* openConditions) {
+void FF_RPG::addSubgoals(SASAction* a) {
 	TVariable var;
 	TValue value;
 	// Add the conditions of the action that do not hold in the frontier state as subgoals 
 	for (unsigned int i = 0; i < a->startCond.size(); i++) {
 		var = a->startCond[i].var;
 		value = a->startCond[i].value;
-		addSubgoal(var, value, openConditions);
+		addSubgoal(var, value);
 	}
 	for (unsigned int i = 0; i < a->overCond.size(); i++) {
 		var = a->overCond[i].var;
 		value = a->overCond[i].value;
-		addSubgoal(var, value, openConditions);
+		addSubgoal(var, value);
 	}
 	/*
 	if (forceAtEndConditions) {
@@ -291,7 +438,7 @@ uint16_t FF_RPG::getDifficulty(SASAction* a) {
 }
 
 uint16_t FF_RPG::getDifficulty(SASCondition* c) {
-	int level = literalLevels[c->var][c->value];
+	int level = getLevel(literal(c->var, c->value));
 	//cout << " * Dif. of (" << task->variables[c->var].name << ", " << task->values[c->value].name << "): " << level << endl;
 	return level > 0 ? level : 0;
 }
@@ -5,8 +5,13 @@
 #include "../utils/priorityQueue.h"
 #include "../sas/sasTask.h"
 #include "../planner/state.h"
+#include "preconditionCounter.h"
 
-class FF_RPGCondition : public PriorityQueueItem {
+#if defined(_DEBUG) || defined(DEBUG_RPG_ON)
+#define CHECK_RPG_REPAIR		// Every repaired graph is checked against a full rebuild
+#endif
+
+class FF_RPGCondition {
 public:
 	TVariable var;
 	TValue value;
@@ -16,12 +21,28 @@ public:
 		value = val;
 		level = l;
 	}
-	inline int compare(PriorityQueueItem* other) {
-		return ((FF_RPGCondition*)other)->level - level;
+};
+
+// Conditions with a higher level are solved first
+class FF_RPGConditionOrder {
+public:
+	inline bool operator()(const FF_RPGCondition& c1, const FF_RPGCondition& c2) const {
+		return c1.level > c2.level;
+	}
+};
+
+typedef PriorityQueue<FF_RPGCondition, FF_RPGConditionOrder> FF_RPGConditionQueue;
+
+// Values with a lower level are updated first when the graph is repaired
+class FF_RPGLevelOrder {
+public:
+	inline bool operator()(const FF_RPGCondition& c1, const FF_RPGCondition& c2) const {
+		return c1.level < c2.level;
 	}
-	virtual ~FF_RPGCondition() { }
 };
 
+typedef PriorityQueue<FF_RPGCondition, FF_RPGLevelOrder> FF_RPGLevelQueue;
+
 class FF_RPGVarValue {
 public:
 	TVariable var;
@@ -29,35 +50,78 @@ public:
 	FF_RPGVarValue(TVariable var, TValue value);
 };
 
+// Relaxed planning graph, reused to evaluate all the states of a search thread. The levels of all the
+// (var, value) pairs are stored in a flat array (indexed as in the precondition counter), and they are
+// only valid if stamped with the current epoch, so the graph is reset in constant time before each evaluation.
+// When the state only differs in a few values from the previous one, the graph is repaired instead: the
+// levels that can increase (because they depended on the removed values) are computed again, and the lower
+// levels reached through the new values are propagated in increasing order
 class FF_RPG {
 private:
 	SASTask* task;
-	std::vector< std::vector<int> > literalLevels;
-    std::vector<int> actionLevels;
-    unsigned int numLevels;
-    std::vector<FF_RPGVarValue>* lastLevel;
-    std::vector<FF_RPGVarValue>* newLevel;
-    std::vector<TVarValue> reachedValues;
-    
-    void initialize();
-    void addEffects(SASAction* a);
-    void addEffect(TVariable var, TValue value);
+	std::vector<SASAction*>* tilActions;
+	PreconditionCounter counters;			// Actions are added to the graph when all their conditions are reached
+	std::vector<int> literalLevels;
+	std::vector<unsigned int> literalEpoch;
+	std::vector<int> actionLevels;
+	std::vector<unsigned int> actionEpoch;
+	unsigned int epoch;
+	unsigned int numLevels;
+	std::vector<FF_RPGVarValue> lastLevel;
+	std::vector<FF_RPGVarValue> newLevel;
+	std::vector<SASAction*> executable;
+	std::vector<unsigned int> reachedValues;
+	FF_RPGConditionQueue openConditions;
+	std::vector<TValue> graphState;			// State from which the current graph was obtained (empty if none)
+	unsigned int maxChanges;				// Maximum number of changed variables to repair the graph
+	std::vector<bool> tilLiteral;			// Values reached at level 0 through the TILs
+	std::vector<TVariable> changedVars;
+	std::vector<bool> affectedLiteral;		// Values and actions whose level can increase in the repaired graph
+	std::vector<bool> affectedAction;
+	std::vector<FF_RPGVarValue> affectedLiterals;
+	std::vector<SASAction*> affectedActions;
+	FF_RPGLevelQueue repairQueue;
+#ifdef CHECK_RPG_REPAIR
+	FF_RPG* rebuiltRPG;						// Scratch graph, always built from scratch
+#endif
+
+	void initialize(TState* fs);
+	void addEffects(SASAction* a);
+	void addEffect(TVariable var, TValue value);
 	void expand();
-	void addSubgoals(std::vector<TVarValue>* goals, PriorityQueue* openConditions);
-	void addSubgoal(TVariable var, TValue value, PriorityQueue* openConditions);
-	void addSubgoals(SASAction* a, PriorityQueue* openConditions);
+	void addSubgoals(std::vector<TVarValue>* goals);
+	void addSubgoal(TVariable var, TValue value);
+	void addSubgoals(SASAction* a);
 	uint16_t getDifficulty(SASAction* a);
 	uint16_t getDifficulty(SASCondition* c);
-	void addTILactions(std::vector<SASAction*>* tilActions);
-	uint16_t computeHeuristic(PriorityQueue* openConditions);
+	void addTILactions();
+	uint16_t computeHeuristic();
 	void resetReachedValues();
-	bool isExecutable(SASAction* a);
+	bool repair(TState* fs);
+	void findAffected();
+	bool isSupported(FF_RPGCondition& c);
+	int computeActionLevel(SASAction* a);
+	void relaxEffects(SASAction* a, int level);
+#ifdef CHECK_RPG_REPAIR
+	void checkRepair(TState* fs, uint16_t h);
+#endif
+	inline unsigned int literal(TVariable var, TValue value) { return counters.literal(var, value); }
+	inline int getLevel(unsigned int l) { return literalEpoch[l] == epoch ? literalLevels[l] : MAX_INT32; }
+	inline void setLevel(unsigned int l, int level) {
+		literalLevels[l] = level;
+		literalEpoch[l] = epoch;
+	}
+	inline int getActionLevel(SASAction* a) { return actionEpoch[a->index] == epoch ? actionLevels[a->index] : MAX_INT32; }
+	inline void setActionLevel(SASAction* a, int level) {
+		actionLevels[a->index] = level;
+		actionEpoch[a->index] = epoch;
+	}
 
 public:
 	std::vector<SASAction*> relaxedPlan;
 
-	FF_RPG(TState* fs, std::vector<SASAction*>* tilActions, SASTask* task);
-	uint16_t evaluate();
+	FF_RPG(SASTask* task, std::vector<SASAction*>* tilActions);
+	uint16_t evaluate(TState* fs);
 };
 
 #endif
@@ -0,0 +1,46 @@
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Bounded cache of heuristic evaluations.              */
+/********************************************************/
+
+#include "heuristicCache.h"
+using namespace std;
+
+/********************************************************/
+/* CLASS: HeuristicCache                                */
+/********************************************************/
+
+// Constructor. The cache has 2^sizeBits entries
+HeuristicCache::HeuristicCache(unsigned int sizeBits)
+{
+	entries.resize((size_t)1 << sizeBits);
+	for (HeuristicCacheEntry& e : entries)
+		e.state = NO_STATE;
+	mask = ((TStateId)1 << sizeBits) - 1;
+	hits = 0;
+	misses = 0;
+}
+
+// Returns the evaluation of a state with the given limit, or nullptr if it is not stored
+HeuristicCacheEntry* HeuristicCache::find(TStateId state, int limit)
+{
+	HeuristicCacheEntry& e = slot(state);
+	if (e.state == state && e.limit == limit) {
+		hits++;
+		return &e;
+	}
+	misses++;
+	return nullptr;
+}
+
+// Stores the evaluation of a state, replacing the previous entry in its slot
+void HeuristicCache::add(TStateId state, int limit, int h, std::vector<SASAction*>& relaxedPlan)
+{
+	HeuristicCacheEntry& e = slot(state);
+	e.state = state;
+	e.limit = limit;
+	e.h = h;
+	e.relaxedPlan.assign(relaxedPlan.begin(), relaxedPlan.end());
+}
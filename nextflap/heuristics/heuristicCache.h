@@ -0,0 +1,54 @@
+#ifndef HEURISTIC_CACHE_H
+#define HEURISTIC_CACHE_H
+
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Bounded cache of heuristic evaluations. Different    */
+/* plans often reach the same frontier state, even when */
+/* the repeated states are not pruned, so the heuristic */
+/* value and the relaxed plan of a state are stored to  */
+/* avoid building its relaxed planning graph again. The */
+/* states are identified by their id in the registry,   */
+/* which is unique for each state, and each one is      */
+/* stored in a fixed slot (direct-mapped table), so the */
+/* oldest entry in the slot is replaced.                */
+/********************************************************/
+
+#include <vector>
+#include "../utils/utils.h"
+#include "../sas/sasTask.h"
+#include "../planner/state.h"
+
+#define DEFAULT_HEURISTIC_CACHE_BITS 14
+
+// Cached evaluation of a frontier state
+class HeuristicCacheEntry {
+public:
+	TStateId state;							// NO_STATE if the entry is empty
+	int limit;								// Expansion limit of the numeric graph used in the evaluation
+	int h;
+	std::vector<SASAction*> relaxedPlan;
+};
+
+class HeuristicCache {
+private:
+	std::vector<HeuristicCacheEntry> entries;
+	TStateId mask;
+	uint64_t hits;
+	uint64_t misses;
+
+	// State ids are consecutive in each shard of the registry, so they are spread over all the slots
+	inline HeuristicCacheEntry& slot(TStateId state) { return entries[state & mask]; }
+
+public:
+	HeuristicCache() : HeuristicCache(DEFAULT_HEURISTIC_CACHE_BITS) { }
+	HeuristicCache(unsigned int sizeBits);
+	HeuristicCacheEntry* find(TStateId state, int limit);
+	void add(TStateId state, int limit, int h, std::vector<SASAction*>& relaxedPlan);
+	inline uint64_t getHits() { return hits; }
+	inline uint64_t getMisses() { return misses; }
+};
+
+#endif
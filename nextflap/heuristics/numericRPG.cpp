@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "numericRPG.h"
 using namespace std;
 
@@ -11,45 +12,66 @@ using namespace std;
 
 //#define NUMRPG_DEBUG
 
-// Constructor
-NumericRPG::NumericRPG(TState* fs, std::vector<SASAction*>* tilActions, SASTask* task, int limit)
+// Constructor. All the conditions of the actions are considered
+NumericRPG::NumericRPG(SASTask* task, std::vector<SASAction*>* tilActions) : counters(task, tilActions, true)
 {
 	this->task = task;
-	this->limit = limit > 100 ? 100 : limit;
-	initialize();
-	createFirstFluentLevel(fs, tilActions);
-	createFirstActionLevel();
-	expand();
+	this->tilActions = tilActions;
+	unsigned int numNumVars = (unsigned int)task->numVariables.size();
+	unsigned int numActions = (unsigned int)task->actions.size();
+	lastVarChange.resize(numNumVars);
+	varEpoch.resize(numNumVars, 0);
+	numVarValue.resize(numNumVars);
+	isReachedNumValue.resize(numNumVars, false);
+	lastActionLevel.resize(numActions);
+	actionEpoch.resize(numActions, 0);
+	literalLevel.resize(counters.getNumLiterals());
+	literalEpoch.resize(counters.getNumLiterals(), 0);
+	epoch = 0;
+	checkedActions.resize(numActions, 0);
+	checkStamp = 0;
+	goalLevel.resize(task->goals.size());
+	limit = 0;
 }
 
-// Graph initialization
-void NumericRPG::initialize()
+// Graph initialization. The previous graph is removed (in constant time, by changing the epoch) and
+// the new one is built from the given state
+void NumericRPG::initialize(TState* fs, int limit)
 {
-	int numVars = task->variables.size();
-	int numValues = task->values.size();
-	int numNumVars = task->numVariables.size();
-	literalLevel.resize(numVars);
-	for (int i = 0; i < numVars; i++) {
-		literalLevel[i].resize(numValues, MAX_INT32);
-	}
-	actionLevel.resize(task->actions.size());
-	numVarProducers.resize(numNumVars);
-	numVarValue.resize(numNumVars);
+	this->limit = limit > 100 ? 100 : limit;
+	if (++epoch == 0) {		// Overflow: the stamps of the previous epochs must be removed
+		fill(literalEpoch.begin(), literalEpoch.end(), 0);
+		fill(actionEpoch.begin(), actionEpoch.end(), 0);
+		fill(varEpoch.begin(), varEpoch.end(), 0);
+		epoch = 1;
+	}
+	varChanges.clear();
+	actionLevels.clear();
+	nextLevel.clear();
+	achievedNumericActions.clear();
+	openConditions.clear();
+	relaxedPlan.clear();
+	remainingGoals.clear();
 	for (SASAction& a : task->goals)
 		remainingGoals.push_back(&a);
-	goalLevel.resize(task->goals.size(), MAX_INT32);
+	fill(goalLevel.begin(), goalLevel.end(), MAX_INT32);
+	createFirstFluentLevel(fs);
+	createFirstActionLevel();
+	expand();
 }
 
 // Build the first fluent level of the graph
-void NumericRPG::createFirstFluentLevel(TState* fs, std::vector<SASAction*>* tilActions)
+void NumericRPG::createFirstFluentLevel(TState* fs)
 {
 #ifdef NUMRPG_DEBUG
 	cout << "L0" << endl;
 #endif
 	// Propositional values
+	counters.reset();
 	for (unsigned int i = 0; i < fs->numSASVars; i++) {
 		TValue v = fs->state[i];
-		literalLevel[i][v] = 0;
+		setLiteralLevel(i, v, 0);
+		counters.reach(counters.literal(i, v), nullptr);
 #ifdef NUMRPG_DEBUG
 		cout << task->variables[i].name << "=" << task->values[v].name << endl;
 #endif
@@ -69,7 +91,10 @@ void NumericRPG::createFirstFluentLevel(TState* fs, std::vector<SASAction*>* til
 			IntervalCalculations ic(a, 0, this, task);
 			ic.applyEndEffects(&v, nullptr);
 			for (SASCondition& c : a->endEff) {
-				literalLevel[c.var][c.value] = 0;
+				if (getLiteralLevel(c.var, c.value) != 0) {
+					setLiteralLevel(c.var, c.value, 0);
+					counters.reach(counters.literal(c.var, c.value), nullptr);
+				}
 			}
 			for (TNumVarChange& c : v) {
 				updateNumericValueInterval(c.v, c.min, c.max);
@@ -115,7 +140,7 @@ void NumericRPG::createFirstActionLevel()
 		else i++;
 	}
 	for (SASAction& a : task->actions) {
-		if (isApplicable(&a, 0)) {
+		if (counters.isExecutable(&a)) {
 			programActionEffects(&a, 1);
 		}
 	}
@@ -125,15 +150,15 @@ void NumericRPG::createFirstActionLevel()
 bool NumericRPG::isApplicable(SASAction* a, int level)
 {
 	for (SASCondition& c : a->startCond) {
-		if (literalLevel[c.var][c.value] > level)
+		if (getLiteralLevel(c.var, c.value) > level)
 			return false;
 	}
 	for (SASCondition& c : a->overCond) {
-		if (literalLevel[c.var][c.value] > level)
+		if (getLiteralLevel(c.var, c.value) > level)
 			return false;
 	}
 	for (SASCondition& c : a->endCond) {
-		if (literalLevel[c.var][c.value] > level)
+		if (getLiteralLevel(c.var, c.value) > level)
 			return false;
 	}
 	return true;
@@ -151,11 +176,11 @@ bool* NumericRPG::calculateCondEffHold(SASAction* a, int level, IntervalCalculat
 
 bool NumericRPG::checkCondEffectHold(SASConditionalEffect& e, int level, IntervalCalculations& ic) {
 	for (SASCondition& c : e.startCond) {
-		if (literalLevel[c.var][c.value] > level)
+		if (getLiteralLevel(c.var, c.value) > level)
 			return false;
 	}
 	for (SASCondition& c : e.endCond) {
-		if (literalLevel[c.var][c.value] > level)
+		if (getLiteralLevel(c.var, c.value) > level)
 			return false;
 	}
 	for (SASNumericCondition& c : e.startNumCond) {
@@ -184,8 +209,8 @@ void NumericRPG::programActionEffects(SASAction* a, int level)
 	}
 	bool newEffects = false;
 	for (SASCondition& c : a->startEff) {
-		if (literalLevel[c.var][c.value] > level) {
-			literalLevel[c.var][c.value] = level;
+		if (getLiteralLevel(c.var, c.value) > level) {
+			setLiteralLevel(c.var, c.value, level);
 			nextLevel.emplace_back(c.var, c.value, a);
 			newEffects = true;
 #ifdef NUMRPG_DEBUG
@@ -194,8 +219,8 @@ void NumericRPG::programActionEffects(SASAction* a, int level)
 		}
 	}
 	for (SASCondition& c : a->endEff) {
-		if (literalLevel[c.var][c.value] > level) {
-			literalLevel[c.var][c.value] = level;
+		if (getLiteralLevel(c.var, c.value) > level) {
+			setLiteralLevel(c.var, c.value, level);
 			nextLevel.emplace_back(c.var, c.value, a);
 			newEffects = true;
 #ifdef NUMRPG_DEBUG
@@ -218,8 +243,8 @@ void NumericRPG::programActionEffects(SASAction* a, int level)
 			if (holdCondPrec[i]) {
 				SASConditionalEffect& e = a->conditionalEff[i];
 				for (SASCondition& c : e.startEff) {
-					if (literalLevel[c.var][c.value] > level) {
-						literalLevel[c.var][c.value] = level;
+					if (getLiteralLevel(c.var, c.value) > level) {
+						setLiteralLevel(c.var, c.value, level);
 						nextLevel.emplace_back(c.var, c.value, a);
 						newEffects = true;
 #ifdef NUMRPG_DEBUG
@@ -228,8 +253,8 @@ void NumericRPG::programActionEffects(SASAction* a, int level)
 					}
 				}
 				for (SASCondition& c : e.endEff) {
-					if (literalLevel[c.var][c.value] > level) {
-						literalLevel[c.var][c.value] = level;
+					if (getLiteralLevel(c.var, c.value) > level) {
+						setLiteralLevel(c.var, c.value, level);
 						nextLevel.emplace_back(c.var, c.value, a);
 						newEffects = true;
 #ifdef NUMRPG_DEBUG
@@ -242,18 +267,18 @@ void NumericRPG::programActionEffects(SASAction* a, int level)
 		delete[] holdCondPrec;
 	}
 	if (newEffects) { // Action generates new values
-		if (actionLevel[a->index].empty() && (a->endNumEff.size() > 0 || a->startNumEff.size() > 0))
+		if (!inGraph(a) && (a->endNumEff.size() > 0 || a->startNumEff.size() > 0))
 			achievedNumericActions.push_back(a);
-		actionLevel[a->index].push_back(level - 1);			   // Action added to the current level
+		addActionLevel(a, level - 1);						   // Action added to the current level
 #ifdef NUMRPG_DEBUG
 		//cout << "\tAction added to level" << endl;
 		cout << a->name << endl;
 #endif
 	}
-	else if (actionLevel[a->index].empty() && a->endNumEff.empty() && a->startNumEff.empty()) {
+	else if (!inGraph(a) && a->endNumEff.empty() && a->startNumEff.empty()) {
 		// Action does not produces new values, but appears the first time and has no numeric effects ->
 		// add to the RPG not to check it again
-		actionLevel[a->index].push_back(level - 1);			   // Action added to the current level
+		addActionLevel(a, level - 1);						   // Action added to the current level
 #ifdef NUMRPG_DEBUG
 		//cout << "\tAction added to level" << endl;
 		cout << a->name << endl;
@@ -279,7 +304,6 @@ void NumericRPG::programNumericEffect(TVariable v, int level, TFloatValue min, T
 void NumericRPG::expand()
 {
 	int currentLevel = 0;
-	std::unordered_set<int> checkedActions;
 	while (remainingGoals.size() > 0 && nextLevel.size() > 0) {
 		currentLevel++;
 #ifdef NUMRPG_DEBUG
@@ -299,28 +323,31 @@ void NumericRPG::expand()
 		cout << "A" << currentLevel << endl;
 #endif
 
+		if (++checkStamp == 0) {		// Overflow: the stamps of the previous levels must be removed
+			fill(checkedActions.begin(), checkedActions.end(), 0);
+			checkStamp = 1;
+		}
 		for (SASAction* a : achievedNumericActions) {
 			programActionEffects(a, currentLevel + 1);
-			checkedActions.insert(a->index);
+			checkedActions[a->index] = checkStamp;
 		}
 
 		for (TVarValue vv : reachedValues) {	// Add actions that require this proposition
 			for (SASAction* a : task->requirers[task->getVariableIndex(vv)][task->getValueIndex(vv)]) {
-				if (checkedActions.find(a->index) == checkedActions.end()) {
+				if (checkedActions[a->index] != checkStamp) {
 					checkAction(a, currentLevel);
-					checkedActions.insert(a->index);
+					checkedActions[a->index] = checkStamp;
 				}
 			}
 		}
 		for (const TVariable& v : reachedNumValues) { // Add actions that need this numeric value
 			for (SASAction* a : task->numRequirers[v]) {
-				if (checkedActions.find(a->index) == checkedActions.end()) {
+				if (checkedActions[a->index] != checkStamp) {
 					checkAction(a, currentLevel);
-					checkedActions.insert(a->index);
+					checkedActions[a->index] = checkStamp;
 				}
 			}
 		}
-		checkedActions.clear();
 	}
 #ifdef NUMRPG_DEBUG
 	cout << "Remaining goals: " << remainingGoals.size() << endl;
@@ -332,6 +359,8 @@ bool NumericRPG::updateNumericValues(int level)
 {
 	bool onlyNumericVariables = true;
 	reachedValues.clear();
+	for (TVariable v : reachedNumValues)
+		isReachedNumValue[v] = false;
 	reachedNumValues.clear();
 	for (NumericRPGEffect& c : nextLevel)
 	{
@@ -339,9 +368,11 @@ bool NumericRPG::updateNumericValues(int level)
 			bool changeMin = c.minValue < numVarValue[c.var].minValue;
 			bool changeMax = c.maxValue > numVarValue[c.var].maxValue;
 			if (changeMin || changeMax) {
-				numVarProducers[c.var].resize(level);
-				NumericRPGproducers& prod = numVarProducers[c.var][level - 1];
-				reachedNumValues.insert(c.var);
+				NumericRPGVarChange& prod = getVarChange(c.var, level - 1);
+				if (!isReachedNumValue[c.var]) {
+					isReachedNumValue[c.var] = true;
+					reachedNumValues.push_back(c.var);
+				}
 				if (changeMin) {
 					numVarValue[c.var].minValue = c.minValue;
 					prod.minProducer = c.a;
@@ -357,6 +388,7 @@ bool NumericRPG::updateNumericValues(int level)
 		else {
 			onlyNumericVariables = false;
 			reachedValues.push_back(task->getVariableValueCode(c.var, c.value));
+			counters.reach(counters.literal(c.var, c.value), nullptr);
 #ifdef NUMRPG_DEBUG
 			cout << task->variables[c.var].name << "=" << task->values[c.value].name << endl;
 #endif
@@ -372,7 +404,7 @@ bool NumericRPG::updateNumericValues(int level)
 			return false;
 		for (TVariable v : reachedNumValues) {
 			for (SASAction* a : task->numRequirers[v]) {
-				if (actionLevel[a->index].empty())
+				if (!inGraph(a))
 					return true;
 			}
 			for (SASAction* g : task->numGoalRequirers[v]) {
@@ -388,10 +420,10 @@ bool NumericRPG::updateNumericValues(int level)
 // Check if an action can be inserted in the graph
 void NumericRPG::checkAction(SASAction* a, int level)
 {
-	if (actionLevel[a->index].size() > 0 && a->endNumEff.empty() && a->startNumEff.empty())
+	if (inGraph(a) && a->endNumEff.empty() && a->startNumEff.empty())
 		return;	// Action already in the RPG without numeric effects
-	if (!isApplicable(a, level))
-		return;	// Action not applicable
+	if (!counters.isExecutable(a))
+		return;	// Action not applicable (its conditions are reached up to this level)
 #ifdef NUMRPG_DEBUG
 	//cout << "Checking " << a->name << endl;
 #endif
@@ -414,8 +446,9 @@ bool NumericRPG::checkGoal(SASAction* a, int level)
 }
 
 // Heuristic evaluation: length of the relaxed plan
-int NumericRPG::evaluate()
+int NumericRPG::evaluate(TState* fs, int limit)
 {
+	initialize(fs, limit);
 	if (remainingGoals.size() > 0) return MAX_UINT16;
 	int h = 0, level;
 	for (SASAction& g : task->goals) {
@@ -423,19 +456,19 @@ int NumericRPG::evaluate()
 	}
 	SASAction* a;
 	while (openConditions.size() > 0) {
-		NumericRPGCondition* c = (NumericRPGCondition*)openConditions.poll();
-		if (c->type == 'V') {
-			a = searchBestAction(c->var, c->value, c->level, &level);
+		NumericRPGCondition c = openConditions.poll();
+		if (c.type == 'V') {
+			a = searchBestAction(c.var, c.value, c.level, &level);
 		}
 		else {
-			level = c->level; 
-			a = c->producer;
+			level = c.level; 
+			a = c.producer;
 		}
 		if (a != nullptr) {
 			h++;
-			addSubgoals(a, level, c->type != 'V' ? c : nullptr);
+			relaxedPlan.push_back(a);
+			addSubgoals(a, level, c.type != 'V' ? &c : nullptr);
 		}
-		delete c;
 	}
 #ifdef NUMRPG_DEBUG
 	cout << "H = " << h << endl;
@@ -444,7 +477,8 @@ int NumericRPG::evaluate()
 }
 
 // Evaluation of the initial plan
-int NumericRPG::evaluateInitialPlan(/*bool* usefulActions*/) {
+int NumericRPG::evaluateInitialPlan(TState* fs, int limit/*, bool* usefulActions*/) {
+	initialize(fs, limit);
 	if (remainingGoals.size() > 0) return MAX_UINT16;
 	int h = 0, level;
 	for (SASAction& g : task->goals) {
@@ -452,23 +486,22 @@ int NumericRPG::evaluateInitialPlan(/*bool* usefulActions*/) {
 	}
 	SASAction* a;
 	while (openConditions.size() > 0) {
-		NumericRPGCondition* c = (NumericRPGCondition*)openConditions.poll();
+		NumericRPGCondition c = openConditions.poll();
 #ifdef NUMRPG_DEBUG
-		cout << "Condition: " << task->variables[c->var].name << "=" << task->values[c->value].name << endl;
+		cout << "Condition: " << task->variables[c.var].name << "=" << task->values[c.value].name << endl;
 #endif
-		if (c->type == 'V') {
-			a = searchBestAction(c->var, c->value, c->level, &level);
+		if (c.type == 'V') {
+			a = searchBestAction(c.var, c.value, c.level, &level);
 		}
 		else {
-			level = c->level;
-			a = c->producer;
+			level = c.level;
+			a = c.producer;
 		}
 		if (a != nullptr) {
 			h++;
 			//usefulActions[a->index] = true;
-			addSubgoals(a, level, c->type != 'V' ? c : nullptr);
+			addSubgoals(a, level, c.type != 'V' ? &c : nullptr);
 		}
-		delete c;
 	}
 #ifdef NUMRPG_DEBUG
 	cout << "H = " << h << endl;
@@ -488,7 +521,7 @@ void NumericRPG::addSubgoals(SASAction* a, int level, NumericRPGCondition* cp)
 		addSubgoal(&c);
 	for (SASCondition& c : a->endCond)
 		addSubgoal(&c);
-	std::vector<NumericRPGCondition*> numCond;
+	std::vector<NumericRPGCondition> numCond;
 	for (SASNumericCondition& c: a->startNumCond)
 		addSubgoal(a, &c, level, &numCond);
 	for (SASNumericCondition& c : a->overNumCond)
@@ -496,12 +529,12 @@ void NumericRPG::addSubgoals(SASAction* a, int level, NumericRPGCondition* cp)
 	for (SASNumericCondition& c : a->endNumCond)
 		addSubgoal(a, &c, level, &numCond);
 	bool needToAddNumVarCond = cp != nullptr;
-	for (NumericRPGCondition* c : numCond) {
+	for (NumericRPGCondition& c : numCond) {
 		openConditions.add(c);
-		if (needToAddNumVarCond && (c->level == level - 1 || (c->type != 'V' && c->var == cp->var)))
+		if (needToAddNumVarCond && (c.level == level - 1 || (c.type != 'V' && c.var == cp->var)))
 			needToAddNumVarCond = false;
 #ifdef NUMRPG_DEBUG
-		cout << "* Level " << (c->level + 1) << ": " << task->numVariables[c->var].name << " (" << c->type << ")" << endl;
+		cout << "* Level " << (c.level + 1) << ": " << task->numVariables[c.var].name << " (" << c.type << ")" << endl;
 #endif
 	}
 	if (needToAddNumVarCond) {
@@ -509,10 +542,10 @@ void NumericRPG::addSubgoals(SASAction* a, int level, NumericRPGCondition* cp)
 		int varLevel = cp->type == '+' ? findMaxNumVarLevel(cp->var, level) : findMinNumVarLevel(cp->var, level);
 		if (varLevel >= 0) {
 			addNumericSubgoal(cp->var, varLevel, cp->type == '+', &numCond);
-			for (NumericRPGCondition* c : numCond) {
+			for (NumericRPGCondition& c : numCond) {
 				openConditions.add(c);
 #ifdef NUMRPG_DEBUG
-				cout << "* Level " << (c->level + 1) << ": " << task->numVariables[c->var].name << " (" << c->type << ")" << endl;
+				cout << "* Level " << (c.level + 1) << ": " << task->numVariables[c.var].name << " (" << c.type << ")" << endl;
 #endif
 			}
 		}
@@ -522,10 +555,10 @@ void NumericRPG::addSubgoals(SASAction* a, int level, NumericRPGCondition* cp)
 // Add the given condition of an action as new subgoal for the relaxed plan
 void NumericRPG::addSubgoal(SASCondition* c)
 {
-	int level = literalLevel[c->var][c->value];
+	int level = getLiteralLevel(c->var, c->value);
 	if (level > 0) {	// Not solved yet
-		literalLevel[c->var][c->value] = 0;		// Not to repeat it again
-		openConditions.add(new NumericRPGCondition(c, level));
+		setLiteralLevel(c->var, c->value, 0);	// Not to repeat it again
+		openConditions.emplace(c, level);
 #ifdef NUMRPG_DEBUG
 		cout << "* Level " << level << ": " << task->variables[c->var].name << "=" << task->values[c->value].name << endl;
 #endif
@@ -533,7 +566,7 @@ void NumericRPG::addSubgoal(SASCondition* c)
 }
 
 // Add the given numeric condition of an action as new subgoal for the relaxed plan
-void NumericRPG::addSubgoal(SASAction* a, SASNumericCondition* c, int level, std::vector<NumericRPGCondition*>* numCond)
+void NumericRPG::addSubgoal(SASAction* a, SASNumericCondition* c, int level, std::vector<NumericRPGCondition>* numCond)
 {
 	switch (c->comp) {
 	case '-': break;
@@ -556,7 +589,7 @@ void NumericRPG::addSubgoal(SASAction* a, SASNumericCondition* c, int level, std
 }
 
 // Add the given (maximize) numeric condition of an action as new subgoal for the relaxed plan
-void NumericRPG::addMaxValueSubgoal(SASAction* a, SASNumericExpression* e, int level, std::vector<NumericRPGCondition*>* numCond)
+void NumericRPG::addMaxValueSubgoal(SASAction* a, SASNumericExpression* e, int level, std::vector<NumericRPGCondition>* numCond)
 {
 	if (e->type == 'V') {
 		int varLevel = findMaxNumVarLevel(e->var, level);
@@ -572,7 +605,7 @@ void NumericRPG::addMaxValueSubgoal(SASAction* a, SASNumericExpression* e, int l
 }
 
 // Add the given (minimize) numeric condition of an action as new subgoal for the relaxed plan
-void NumericRPG::addMinValueSubgoal(SASAction* a, SASNumericExpression* e, int level, std::vector<NumericRPGCondition*>* numCond)
+void NumericRPG::addMinValueSubgoal(SASAction* a, SASNumericExpression* e, int level, std::vector<NumericRPGCondition>* numCond)
 {
 	if (e->type == 'V') {
 		int varLevel = findMinNumVarLevel(e->var, level);
@@ -588,13 +621,15 @@ void NumericRPG::addMinValueSubgoal(SASAction* a, SASNumericExpression* e, int l
 }
 
 // Add the given condition of an action as new subgoal for the relaxed plan
-void NumericRPG::addNumericSubgoal(TVariable v, int level, bool max, std::vector<NumericRPGCondition*>* numCond) {
-	TVarValue vv = task->getVariableValueCode(v, level);
-	if (numericSubgoals.find(vv) != numericSubgoals.end()) return;
-	numericSubgoals.insert(vv);
-	NumericRPGproducers& prod = numVarProducers[v][level];
+void NumericRPG::addNumericSubgoal(TVariable v, int level, bool max, std::vector<NumericRPGCondition>* numCond) {
+	int i = getLastVarChange(v);
+	while (i != -1 && varChanges[i].level > level)
+		i = varChanges[i].prev;
+	if (i == -1 || varChanges[i].level != level || varChanges[i].subgoal) return;
+	NumericRPGVarChange& prod = varChanges[i];
+	prod.subgoal = true;
 	SASAction* a = max ? prod.maxProducer : prod.minProducer;
-	numCond->push_back(new NumericRPGCondition(v, max, level, a));
+	numCond->emplace_back(v, max, level, a);
 }
 
 // Searches the best action to support the condition
@@ -633,12 +668,9 @@ SASAction* NumericRPG::searchBestAction(TVariable v, TValue value, int level, in
 // Check the last level (before maxLevel) where v changes its lower value
 int NumericRPG::findMinNumVarLevel(TVariable v, int maxLevel)
 {
-	std::vector<NumericRPGproducers>& prod = numVarProducers[v];
-	int level = maxLevel;
-	if (prod.size() < level) level = (int)prod.size();
-	for (int i = level - 1; i >= 0; i--) {
-		if (prod[i].minProducer != nullptr)
-			return i;
+	for (int i = getLastVarChange(v); i != -1; i = varChanges[i].prev) {
+		if (varChanges[i].level < maxLevel && varChanges[i].minProducer != nullptr)
+			return varChanges[i].level;
 	}
 	return -1;
 }
@@ -646,12 +678,9 @@ int NumericRPG::findMinNumVarLevel(TVariable v, int maxLevel)
 // Check the last level (before maxLevel) where v changes its higher value
 int NumericRPG::findMaxNumVarLevel(TVariable v, int maxLevel)
 {
-	std::vector<NumericRPGproducers>& prod = numVarProducers[v];
-	int level = (int)prod.size();
-	if (level > maxLevel) level = maxLevel;
-	for (int i = level - 1; i >= 0; i--) {
-		if (prod[i].maxProducer != nullptr)
-			return i;
+	for (int i = getLastVarChange(v); i != -1; i = varChanges[i].prev) {
+		if (varChanges[i].level < maxLevel && varChanges[i].maxProducer != nullptr)
+			return varChanges[i].level;
 	}
 	return -1;
 }
@@ -659,15 +688,35 @@ int NumericRPG::findMaxNumVarLevel(TVariable v, int maxLevel)
 // Check the last level (before maxLevel) where v changes its value
 int NumericRPG::findLevel(int actionIndex, int maxLevel)
 {
-	std::vector<int>& levels = actionLevel[actionIndex];
-	for (int i = (int)levels.size() - 1; i >= 0; i--)
+	for (int i = getLastActionLevel(actionIndex); i != -1; i = actionLevels[i].prev)
 	{ 
-		if (levels[i] < maxLevel)
-			return levels[i];
+		if (actionLevels[i].level < maxLevel)
+			return actionLevels[i].level;
 	}
 	return -1;
 }
 
+// Returns the change of a numeric variable in the given level. It is created if the variable has not changed
+// in this level yet (the levels are built in order)
+NumericRPGVarChange& NumericRPG::getVarChange(TVariable v, int level)
+{
+	int last = getLastVarChange(v);
+	if (last != -1 && varChanges[last].level == level)
+		return varChanges[last];
+	varChanges.emplace_back(level, last);
+	lastVarChange[v] = (int)varChanges.size() - 1;
+	varEpoch[v] = epoch;
+	return varChanges.back();
+}
+
+// Adds a new level where an action appears
+void NumericRPG::addActionLevel(SASAction* a, int level)
+{
+	actionLevels.emplace_back(level, getLastActionLevel(a->index));
+	lastActionLevel[a->index] = (int)actionLevels.size() - 1;
+	actionEpoch[a->index] = epoch;
+}
+
 // Returns the lower value of a variable
 TFloatValue NumericRPG::getMinValue(TVariable v, int numState) 
 {
@@ -10,11 +10,11 @@
 /********************************************************/
 
 #include <vector>
-#include <unordered_set>
 #include "../utils/priorityQueue.h"
 #include "../sas/sasTask.h"
 #include "../planner/state.h"
 #include "../planner/intervalCalculations.h"
+#include "preconditionCounter.h"
 
 // Numeric effect of an action
 class NumericRPGEffect {
@@ -42,7 +42,7 @@ public:
 };
 
 // Numeric condition
-class NumericRPGCondition : public PriorityQueueItem {
+class NumericRPGCondition {
 public:
 	char type;	// 'V': sas variable, '-': numeric var (minimum value required), '+': numeric var (maximum value required)
 	TVariable var;
@@ -55,50 +55,82 @@ public:
 		var = c->var;
 		value = c->value;
 		level = l;
+		producer = nullptr;
 	}
 	NumericRPGCondition(TVariable v, bool maxRequired, int l, SASAction* p) {
 		type = maxRequired ? '+' : '-';
 		var = v;
+		value = 0;
 		level = l;
 		producer = p;
 	}
-	inline int compare(PriorityQueueItem* other) {
-		return ((NumericRPGCondition*)other)->level - level;
+};
+
+// Conditions with a higher level are solved first
+class NumericRPGConditionOrder {
+public:
+	inline bool operator()(const NumericRPGCondition& c1, const NumericRPGCondition& c2) const {
+		return c1.level > c2.level;
 	}
-	virtual ~NumericRPGCondition() { }
 };
 
-// Actions that produce a given value interval for a variable
-class NumericRPGproducers {
+// Change of the value interval of a numeric variable in a level, and the actions that produced it. The
+// changes of each variable are linked from the last one backwards
+class NumericRPGVarChange {
 public:
+	int level;
+	int prev;			// Previous change of the same variable (-1 if none)
 	SASAction* minProducer;
 	float minValue;
 	SASAction* maxProducer;
 	float maxValue;
+	bool subgoal;		// Already added as a subgoal for the relaxed plan
+
+	NumericRPGVarChange(int l, int p) { level = l; prev = p; minProducer = maxProducer = nullptr; subgoal = false; }
+};
 
-	NumericRPGproducers() { minProducer = maxProducer = nullptr; }
+// Level where an action appears. The levels of each action are linked from the last one backwards
+class NumericRPGActionLevel {
+public:
+	int level;
+	int prev;			// Previous level of the same action (-1 if none)
+
+	NumericRPGActionLevel(int l, int p) { level = l; prev = p; }
 };
 
-// Numeric relaxed planning graph
+// Numeric relaxed planning graph, reused to evaluate all the states of a search thread. All the levels
+// are stored in flat arrays, and the positions of the literals, actions and variables are only valid if
+// stamped with the current epoch, so the graph is reset in time proportional to the part used in the
+// previous evaluation
 class NumericRPG : public FluentIntervalData {
 private:
 	SASTask* task;
+	std::vector<SASAction*>* tilActions;
+	PreconditionCounter counters;						 // Propositional conditions of the actions reached so far
 	std::vector<SASAction*> remainingGoals;
-	std::vector< std::vector<NumericRPGproducers> > numVarProducers; // For each numeric variable, the actions that updated its value interval
-	std::vector<TInterval> numVarValue;					   // Last value interval for each variable
-	std::vector< std::vector<int> > actionLevel;		   // Levels where the action appears
-	std::vector< std::vector<int> > literalLevel;		   // Level of each pair (variable, value)
+	std::vector<NumericRPGVarChange> varChanges;		 // Changes of the numeric variables, in order
+	std::vector<int> lastVarChange;						 // Last change of each numeric variable
+	std::vector<unsigned int> varEpoch;
+	std::vector<TInterval> numVarValue;					 // Last value interval for each variable
+	std::vector<NumericRPGActionLevel> actionLevels;	 // Levels where the actions appear, in order
+	std::vector<int> lastActionLevel;					 // Last level of each action
+	std::vector<unsigned int> actionEpoch;
+	std::vector<int> literalLevel;						 // Level of each pair (variable, value)
+	std::vector<unsigned int> literalEpoch;
+	unsigned int epoch;
 	std::vector<NumericRPGEffect> nextLevel;
 	std::vector<TVarValue> reachedValues;
-	std::unordered_set<TVariable> reachedNumValues;
+	std::vector<TVariable> reachedNumValues;			 // Numeric variables changed in the current level
+	std::vector<bool> isReachedNumValue;
+	std::vector<unsigned int> checkedActions;			 // Actions checked in the current level (if stamped)
+	unsigned int checkStamp;
 	std::vector<int> goalLevel;
-	PriorityQueue openConditions;
+	PriorityQueue<NumericRPGCondition, NumericRPGConditionOrder> openConditions;
 	std::vector<SASAction*> achievedNumericActions;
-	std::unordered_set<TVarValue> numericSubgoals;
 	int limit;
 
-	void initialize();
-	void createFirstFluentLevel(TState* fs, std::vector<SASAction*>* tilActions);
+	void initialize(TState* fs, int limit);
+	void createFirstFluentLevel(TState* fs);
 	void updateNumericValueInterval(int var, float minValue, float maxValue);
 	void createFirstActionLevel();
 	bool isApplicable(SASAction* a, int level);
@@ -110,21 +142,37 @@ private:
 	bool checkGoal(SASAction* a, int level);
 	void addSubgoals(SASAction* a, int level, NumericRPGCondition* cp);
 	void addSubgoal(SASCondition* c);
-	void addSubgoal(SASAction* a, SASNumericCondition* c, int level, std::vector<NumericRPGCondition*>* numCond);
+	void addSubgoal(SASAction* a, SASNumericCondition* c, int level, std::vector<NumericRPGCondition>* numCond);
 	SASAction* searchBestAction(TVariable v, TValue value, int level, int* actionLevel);
 	int findLevel(int actionIndex, int maxLevel);
 	int findMinNumVarLevel(TVariable v, int maxLevel);
 	int findMaxNumVarLevel(TVariable v, int maxLevel);
-	void addMinValueSubgoal(SASAction* a, SASNumericExpression* e, int level, std::vector<NumericRPGCondition*>* numCond);
-	void addMaxValueSubgoal(SASAction* a, SASNumericExpression* e, int level, std::vector<NumericRPGCondition*>* numCond);
-	void addNumericSubgoal(TVariable v, int level, bool max, std::vector<NumericRPGCondition*>* numCond);
+	void addMinValueSubgoal(SASAction* a, SASNumericExpression* e, int level, std::vector<NumericRPGCondition>* numCond);
+	void addMaxValueSubgoal(SASAction* a, SASNumericExpression* e, int level, std::vector<NumericRPGCondition>* numCond);
+	void addNumericSubgoal(TVariable v, int level, bool max, std::vector<NumericRPGCondition>* numCond);
 	bool* calculateCondEffHold(SASAction* a, int level, IntervalCalculations& ic);
 	bool checkCondEffectHold(SASConditionalEffect& e, int level, IntervalCalculations& ic);
+	NumericRPGVarChange& getVarChange(TVariable v, int level);
+	void addActionLevel(SASAction* a, int level);
+	inline int getLastVarChange(TVariable v) { return varEpoch[v] == epoch ? lastVarChange[v] : -1; }
+	inline int getLastActionLevel(unsigned int a) { return actionEpoch[a] == epoch ? lastActionLevel[a] : -1; }
+	inline bool inGraph(SASAction* a) { return getLastActionLevel(a->index) != -1; }
+	inline int getLiteralLevel(TVariable var, TValue value) {
+		unsigned int l = counters.literal(var, value);
+		return literalEpoch[l] == epoch ? literalLevel[l] : MAX_INT32;
+	}
+	inline void setLiteralLevel(TVariable var, TValue value, int level) {
+		unsigned int l = counters.literal(var, value);
+		literalLevel[l] = level;
+		literalEpoch[l] = epoch;
+	}
 
 public:
-	NumericRPG(TState* fs, std::vector<SASAction*>* tilActions, SASTask* task, int limit);
-	int evaluate();
-	int evaluateInitialPlan(/*bool* usefulActions*/);
+	std::vector<SASAction*> relaxedPlan;	// Actions of the relaxed plan computed in evaluate
+
+	NumericRPG(SASTask* task, std::vector<SASAction*>* tilActions);
+	int evaluate(TState* fs, int limit);
+	int evaluateInitialPlan(TState* fs, int limit/*, bool* usefulActions*/);
 	TFloatValue getMinValue(TVariable v, int numState);
 	TFloatValue getMaxValue(TVariable v, int numState);
 };
@@ -0,0 +1,150 @@
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Propagation kernel for relaxed planning graphs.      */
+/********************************************************/
+
+#include <algorithm>
+#include "preconditionCounter.h"
+using namespace std;
+
+/********************************************************/
+/* CLASS: PreconditionCounter                           */
+/********************************************************/
+
+// Constructor. The counted conditions are the start and over-all conditions of the actions (and also the
+// at-end ones, if endConditions is true). The literals of each variable take the range between its lowest
+// and its highest value in the task
+PreconditionCounter::PreconditionCounter(SASTask* task, std::vector<SASAction*>* tilActions, bool endConditions)
+{
+	this->task = task;
+	unsigned int numVars = (unsigned int)task->variables.size();
+	minValue.resize(numVars, MAX_UINT16);
+	vector<TValue> maxValue(numVars, 0);
+	for (unsigned int i = 0; i < numVars; i++) {
+		for (unsigned int v : task->variables[i].possibleValues)
+			addDomainValue(i, v, maxValue);
+		addDomainValue(i, task->initialState[i], maxValue);
+	}
+	for (SASAction& a : task->actions)
+		addDomainValues(&a, maxValue);
+	for (SASAction& a : task->goals)
+		addDomainValues(&a, maxValue);
+	if (tilActions != nullptr) {
+		for (SASAction* a : *tilActions)
+			addDomainValues(a, maxValue);
+	}
+	for (TVarValue g : *(task->getListOfGoals()))
+		addDomainValue(SASTask::getVariableIndex(g), SASTask::getValueIndex(g), maxValue);
+	varOffset.resize(numVars);
+	unsigned int numLiterals = 0;
+	for (unsigned int i = 0; i < numVars; i++) {
+		varOffset[i] = numLiterals;
+		if (minValue[i] <= maxValue[i]) numLiterals += maxValue[i] - minValue[i] + 1;
+		else minValue[i] = 0;
+	}
+	// Conditions of each action. Actions without counted conditions are triggered by their other conditions
+	unsigned int numActions = (unsigned int)task->actions.size();
+	vector<vector<unsigned int> > counted(numActions), others(numActions);
+	numConditions.resize(numActions);
+	requirersStart.resize(numLiterals + 1, 0);
+	triggersStart.resize(numLiterals + 1, 0);
+	for (unsigned int i = 0; i < numActions; i++) {
+		addConditions(&(task->actions[i]), endConditions, counted[i], others[i]);
+		numConditions[i] = (int)counted[i].size();
+		for (unsigned int l : counted[i]) requirersStart[l + 1]++;
+		if (counted[i].empty()) {
+			for (unsigned int l : others[i]) triggersStart[l + 1]++;
+		}
+	}
+	for (unsigned int l = 0; l < numLiterals; l++) {
+		requirersStart[l + 1] += requirersStart[l];
+		triggersStart[l + 1] += triggersStart[l];
+	}
+	requirers.resize(requirersStart[numLiterals]);
+	triggers.resize(triggersStart[numLiterals]);
+	vector<unsigned int> requirersPos(requirersStart.begin(), requirersStart.end() - 1);
+	vector<unsigned int> triggersPos(triggersStart.begin(), triggersStart.end() - 1);
+	for (unsigned int i = 0; i < numActions; i++) {
+		for (unsigned int l : counted[i]) requirers[requirersPos[l]++] = i;
+		if (counted[i].empty()) {
+			for (unsigned int l : others[i]) triggers[triggersPos[l]++] = i;
+		}
+	}
+	unreached = numConditions;
+	counterEpoch.resize(numActions, 0);
+	epoch = 0;
+}
+
+void PreconditionCounter::addDomainValue(TVariable var, TValue value, std::vector<TValue>& maxValue)
+{
+	if (value < minValue[var]) minValue[var] = value;
+	if (value > maxValue[var]) maxValue[var] = value;
+}
+
+void PreconditionCounter::addDomainValues(SASAction* a, std::vector<TValue>& maxValue)
+{
+	for (SASCondition& c : a->startCond) addDomainValue(c.var, c.value, maxValue);
+	for (SASCondition& c : a->overCond) addDomainValue(c.var, c.value, maxValue);
+	for (SASCondition& c : a->endCond) addDomainValue(c.var, c.value, maxValue);
+	for (SASCondition& c : a->startEff) addDomainValue(c.var, c.value, maxValue);
+	for (SASCondition& c : a->endEff) addDomainValue(c.var, c.value, maxValue);
+	for (SASConditionalEffect& e : a->conditionalEff) {
+		for (SASCondition& c : e.startCond) addDomainValue(c.var, c.value, maxValue);
+		for (SASCondition& c : e.endCond) addDomainValue(c.var, c.value, maxValue);
+		for (SASCondition& c : e.startEff) addDomainValue(c.var, c.value, maxValue);
+		for (SASCondition& c : e.endEff) addDomainValue(c.var, c.value, maxValue);
+	}
+}
+
+// Classifies the conditions of an action. The other conditions are the ones that also make the action
+// a requirer of a value in the task (SASTask::computeRequirers)
+void PreconditionCounter::addConditions(SASAction* a, bool endConditions, std::vector<unsigned int>& counted,
+	std::vector<unsigned int>& others)
+{
+	for (SASCondition& c : a->startCond) addCondition(c.var, c.value, counted);
+	for (SASCondition& c : a->overCond) addCondition(c.var, c.value, counted);
+	for (SASCondition& c : a->endCond) addCondition(c.var, c.value, endConditions ? counted : others);
+	for (SASConditionalEffect& e : a->conditionalEff) {
+		for (SASCondition& c : e.startCond) addCondition(c.var, c.value, others);
+		for (SASCondition& c : e.endCond) addCondition(c.var, c.value, others);
+	}
+}
+
+// Adds a condition, checking for no duplicates
+void PreconditionCounter::addCondition(TVariable var, TValue value, std::vector<unsigned int>& conditions)
+{
+	unsigned int l = literal(var, value);
+	if (find(conditions.begin(), conditions.end(), l) == conditions.end())
+		conditions.push_back(l);
+}
+
+// Resets the counters (in constant time, by changing the epoch)
+void PreconditionCounter::reset()
+{
+	if (++epoch == 0) {		// Overflow: the stamps of the previous epochs must be removed
+		fill(counterEpoch.begin(), counterEpoch.end(), 0);
+		epoch = 1;
+	}
+}
+
+// Marks a literal as reached. It must be called only once per literal after each reset. If a list is
+// given, the actions that become executable are added to it, along with the actions without counted
+// conditions that require this literal (they can be added several times)
+void PreconditionCounter::reach(unsigned int literal, std::vector<SASAction*>* executable)
+{
+	for (unsigned int i = requirersStart[literal]; i < requirersStart[literal + 1]; i++) {
+		unsigned int a = requirers[i];
+		if (counterEpoch[a] != epoch) {
+			counterEpoch[a] = epoch;
+			unreached[a] = numConditions[a];
+		}
+		if (--unreached[a] == 0 && executable != nullptr)
+			executable->push_back(&(task->actions[a]));
+	}
+	if (executable != nullptr) {
+		for (unsigned int i = triggersStart[literal]; i < triggersStart[literal + 1]; i++)
+			executable->push_back(&(task->actions[triggers[i]]));
+	}
+}
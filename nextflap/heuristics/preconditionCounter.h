@@ -0,0 +1,52 @@
+#ifndef PRECONDITION_COUNTER_H
+#define PRECONDITION_COUNTER_H
+
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Propagation kernel for relaxed planning graphs. Each */
+/* action keeps the number of its (distinct) conditions */
+/* that have not been reached yet, so it is known to be */
+/* executable in constant time when the last one is     */
+/* reached, instead of scanning all its conditions each */
+/* time one of them is reached. The counters are        */
+/* stamped with an epoch, so they are reset in constant */
+/* time for each new graph.                             */
+/********************************************************/
+
+#include <vector>
+#include "../utils/utils.h"
+#include "../sas/sasTask.h"
+
+class PreconditionCounter {
+private:
+	SASTask* task;
+	std::vector<unsigned int> varOffset;		// Position of the first value of each variable in the literal arrays
+	std::vector<TValue> minValue;				// Lowest value of each variable
+	std::vector<unsigned int> requirersStart;	// For each literal, position of its first requirer (CSR)
+	std::vector<unsigned int> requirers;		// Actions that have each literal as a counted condition
+	std::vector<unsigned int> triggersStart;	// For each literal, position of its first trigger (CSR)
+	std::vector<unsigned int> triggers;			// Actions without counted conditions that require each literal
+	std::vector<int> numConditions;				// Number of counted conditions of each action
+	std::vector<int> unreached;					// Counted conditions not reached yet (if stamped with the current epoch)
+	std::vector<unsigned int> counterEpoch;
+	unsigned int epoch;
+
+	void addDomainValue(TVariable var, TValue value, std::vector<TValue>& maxValue);
+	void addDomainValues(SASAction* a, std::vector<TValue>& maxValue);
+	void addConditions(SASAction* a, bool endConditions, std::vector<unsigned int>& counted,
+		std::vector<unsigned int>& others);
+	void addCondition(TVariable var, TValue value, std::vector<unsigned int>& conditions);
+	inline int getUnreached(unsigned int a) { return counterEpoch[a] == epoch ? unreached[a] : numConditions[a]; }
+
+public:
+	PreconditionCounter(SASTask* task, std::vector<SASAction*>* tilActions, bool endConditions);
+	void reset();
+	void reach(unsigned int literal, std::vector<SASAction*>* executable);
+	inline unsigned int getNumLiterals() { return (unsigned int)requirersStart.size() - 1; }
+	inline unsigned int literal(TVariable var, TValue value) { return varOffset[var] + value - minValue[var]; }
+	inline bool isExecutable(SASAction* a) { return getUnreached(a->index) <= 0; }
+};
+
+#endif
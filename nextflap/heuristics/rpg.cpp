@@ -14,14 +14,17 @@ RPGVarValue::RPGVarValue(TVariable var, TValue value) {
 	this->value = value;
 }
 
-RPG::RPG(vector< vector<TValue> >& varValues, SASTask* task, bool forceAtEndConditions, std::vector<SASAction*>* tilActions) {
+RPG::RPG(vector< vector<TValue> >& varValues, SASTask* task, bool forceAtEndConditions, std::vector<SASAction*>* tilActions) :
+	counters(task, tilActions, forceAtEndConditions) {
 	this->task = task;
 	this->forceAtEndConditions = forceAtEndConditions;
 	initialize();
 	for (unsigned int i = 0; i < varValues.size(); i++) {
 		for (unsigned int j = 0; j < varValues[i].size(); j++) {
-			lastLevel->emplace_back(i, varValues[i][j]);
-			literalLevels[i][varValues[i][j]] = 0;
+			if (literalLevels[i][varValues[i][j]] != 0) {
+				lastLevel->emplace_back(i, varValues[i][j]);
+				literalLevels[i][varValues[i][j]] = 0;
+			}
 		}
 	}
 	if (tilActions != nullptr) {
@@ -30,7 +33,8 @@ RPG::RPG(vector< vector<TValue> >& varValues, SASTask* task, bool forceAtEndCond
 	expand();
 }
 
-RPG::RPG(TState* state, SASTask* task, bool forceAtEndConditions, std::vector<SASAction*>* tilActions) {
+RPG::RPG(TState* state, SASTask* task, bool forceAtEndConditions, std::vector<SASAction*>* tilActions) :
+	counters(task, tilActions, forceAtEndConditions) {
 	this->task = task;
 	this->forceAtEndConditions = forceAtEndConditions;
 	initialize();
@@ -65,25 +69,22 @@ void RPG::expand() {
 	numLevels = 0;
 	while (lastLevel->size() > 0) {
 		newLevel->clear();
+		executable.clear();
 		for (unsigned int i = 0; i < lastLevel->size(); i++) {
 			TVariable var = (*lastLevel)[i].var;
 			TValue value = (*lastLevel)[i].value;
 #ifdef DEBUG_RPG_ON
 			cout << "(" << task->variables[var].name << "," << task->values[value].name << ")" << endl;
 #endif
-			vector<SASAction*>& actions = task->requirers[var][value];
-#ifdef DEBUG_RPG_ON
-			cout << actions.size() << " actions" << endl;
-#endif
-			for (unsigned int j = 0; j < actions.size(); j++) {
-				SASAction* a = actions[j];
-				if (actionLevels[a->index] == MAX_INT32 && isExecutable(a)) {
+			counters.reach(counters.literal(var, value), &executable);	// Actions whose conditions are all reached
+		}
+		for (SASAction* a : executable) {
+			if (actionLevels[a->index] == MAX_INT32) {
 #ifdef DEBUG_RPG_ON
-					cout << "[" << numLevels << "] " << a->name << endl;
+				cout << "[" << numLevels << "] " << a->name << endl;
 #endif
-					actionLevels[a->index] = numLevels;
-					addEffects(a);
-				}
+				actionLevels[a->index] = numLevels;
+				addEffects(a);
 			}
 		}
 		if (numLevels == 0) {
@@ -168,25 +169,24 @@ void RPG::resetReachedValues() {
 	reachedValues.clear();
 }
 
-uint16_t RPG::computeHeuristic(bool mutex, PriorityQueue* openConditions) {
+uint16_t RPG::computeHeuristic(bool mutex, RPGConditionQueue* openConditions) {
 	int gLevel;
 	uint16_t bestCost;
 	uint16_t h = 0;
 	while (openConditions->size() > 0) {
-		RPGCondition* g = (RPGCondition*)openConditions->poll();
-		//if (debug) cout << "Condition: " << task->variables[g->var].name << " = " << task->values[g->value].name << " (level " << literalLevels[g->var][g->value] << ")" << endl;
+		RPGCondition g = openConditions->poll();
+		//if (debug) cout << "Condition: " << task->variables[g.var].name << " = " << task->values[g.value].name << " (level " << literalLevels[g.var][g.value] << ")" << endl;
 #ifdef DEBUG_RPG_ON
-		cout << "Condition: " << task->variables[g->var].name << " = " << task->values[g->value].name << " (level " << literalLevels[g->var][g->value] << ")" << endl;
+		cout << "Condition: " << task->variables[g.var].name << " = " << task->values[g.value].name << " (level " << literalLevels[g.var][g.value] << ")" << endl;
 #endif
-		gLevel = literalLevels[g->var][g->value];
+		gLevel = literalLevels[g.var][g.value];
 		if (gLevel <= 0) {
-			delete g;
 			continue;
 		}
 		if (gLevel == MAX_INT32) return MAX_UINT16;
-		literalLevels[g->var][g->value] = -gLevel;
-		reachedValues.push_back(SASTask::getVariableValueCode(g->var, g->value));
-		vector<SASAction*>& prod = task->producers[g->var][g->value];
+		literalLevels[g.var][g.value] = -gLevel;
+		reachedValues.push_back(SASTask::getVariableValueCode(g.var, g.value));
+		vector<SASAction*>& prod = task->producers[g.var][g.value];
 		SASAction* bestAction = nullptr;
 		bestCost = MAX_UINT16;
 		for (unsigned int i = 0; i < prod.size(); i++) {
@@ -212,7 +212,6 @@ uint16_t RPG::computeHeuristic(bool mutex, PriorityQueue* openConditions) {
 				}
 			}
 		}
-		delete g;
 		if (bestAction != nullptr) {
 			//if (debug) cout << bestAction->name << endl;
 #ifdef DEBUG_RPG_ON
@@ -236,21 +235,21 @@ uint16_t RPG::computeHeuristic(bool mutex, PriorityQueue* openConditions) {
 
 uint16_t RPG::evaluate(bool mutex) {
 	resetReachedValues();
-	PriorityQueue openConditions(128);
+	RPGConditionQueue openConditions(128);
 	addSubgoals(task->getListOfGoals(), &openConditions);
 	return computeHeuristic(mutex, &openConditions);
 }
 
 uint16_t RPG::evaluate(TVarValue goal, bool mutex) {
 	resetReachedValues();
-	PriorityQueue openConditions(128);
+	RPGConditionQueue openConditions(128);
 	addSubgoal(SASTask::getVariableIndex(goal), SASTask::getValueIndex(goal), &openConditions);
 	return computeHeuristic(mutex, &openConditions);
 }
 
 uint16_t RPG::evaluate(std::vector<TVarValue>* goals, bool mutex) {
 	resetReachedValues();
-	PriorityQueue openConditions(128);
+	RPGConditionQueue openConditions(128);
 	for (unsigned int i = 0; i < goals->size(); i++) {
 		TVarValue vv = goals->at(i);
 		addSubgoal(SASTask::getVariableIndex(vv), SASTask::getValueIndex(vv), &openConditions);
@@ -265,7 +264,7 @@ void RPG::addUsefulAction(SASAction* a, std::vector<SASAction*>* usefulActions)
 	usefulActions->push_back(a);
 }
 
-void RPG::addSubgoals(std::vector<TVarValue>* goals, PriorityQueue* openConditions) {
+void RPG::addSubgoals(std::vector<TVarValue>* goals, RPGConditionQueue* openConditions) {
 	TVariable var;
 	TValue value;
 	for (unsigned int i = 0; i < goals->size(); i++) {
@@ -275,17 +274,17 @@ void RPG::addSubgoals(std::vector<TVarValue>* goals, PriorityQueue* openConditio
 	}
 }
 
-void RPG::addSubgoal(TVariable var, TValue value, PriorityQueue* openConditions) {
+void RPG::addSubgoal(TVariable var, TValue value, RPGConditionQueue* openConditions) {
 	int level = literalLevels[var][value];
 	if (level > 0) {
-		openConditions->add(new RPGCondition(var, value, level));
+		openConditions->emplace(var, value, level);
 #ifdef DEBUG_RPG_ON
 		cout << "* Adding subgoal: " << task->variables[var].name << " = " << task->values[value].name << " (level " << level << ")" << endl;
 #endif
 	}
 }
 
-void RPG::addSubgoals(SASAction* a, PriorityQueue* openConditions) {
+void RPG::addSubgoals(SASAction* a, RPGConditionQueue* openConditions) {
 	TVariable var;
 	TValue value;
 	// Add the conditions of the action that do not hold in the frontier state as subgoals 
@@ -13,8 +13,9 @@
 #include "../utils/priorityQueue.h"
 #include "../sas/sasTask.h"
 #include "../planner/state.h"
+#include "preconditionCounter.h"
 
-class RPGCondition : public PriorityQueueItem {
+class RPGCondition {
 public:
 	TVariable var;
 	TValue value;
@@ -24,12 +25,18 @@ public:
 		value = val;
 		level = l;
 	}
-	inline int compare(PriorityQueueItem* other) {
-		return ((RPGCondition*)other)->level - level;
+};
+
+// Conditions with a higher level are solved first
+class RPGConditionOrder {
+public:
+	inline bool operator()(const RPGCondition& c1, const RPGCondition& c2) const {
+		return c1.level > c2.level;
 	}
-	virtual ~RPGCondition() { }
 };
 
+typedef PriorityQueue<RPGCondition, RPGConditionOrder> RPGConditionQueue;
+
 class RPGVarValue {
 public:
 	TVariable var;
@@ -41,26 +48,28 @@ class RPG {
 private:
 	SASTask* task;
 	bool forceAtEndConditions;
+	PreconditionCounter counters;
 	std::vector< std::vector<int> > literalLevels;
 	std::vector<int> actionLevels;
 	unsigned int numLevels;
 	std::vector<RPGVarValue>* lastLevel;
 	std::vector<RPGVarValue>* newLevel;
 	std::vector<TVarValue> reachedValues;
+	std::vector<SASAction*> executable;
 
 	void initialize();
 	void addEffects(SASAction* a);
 	void addEffect(TVariable var, TValue value);
 	void expand();
-	void addSubgoals(std::vector<TVarValue>* goals, PriorityQueue* openConditions);
-	void addSubgoal(TVariable var, TValue value, PriorityQueue* openConditions);
-	void addSubgoals(SASAction* a, PriorityQueue* openConditions);
+	void addSubgoals(std::vector<TVarValue>* goals, RPGConditionQueue* openConditions);
+	void addSubgoal(TVariable var, TValue value, RPGConditionQueue* openConditions);
+	void addSubgoals(SASAction* a, RPGConditionQueue* openConditions);
 	uint16_t getDifficulty(SASAction* a);
 	uint16_t getDifficulty(SASCondition* c);
 	uint16_t getDifficultyWithPermanentMutex(SASAction* a);
 	void addTILactions(std::vector<SASAction*>* tilActions);
 	void addUsefulAction(SASAction* a, std::vector<SASAction*>* usefulActions);
-	uint16_t computeHeuristic(bool mutex, PriorityQueue* openConditions);
+	uint16_t computeHeuristic(bool mutex, RPGConditionQueue* openConditions);
 	void resetReachedValues();
 
 public:
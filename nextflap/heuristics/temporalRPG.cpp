@@ -47,10 +47,7 @@ void TemporalRPG::addGoalToAchieve(SASCondition& c) {
 }
 
 void TemporalRPG::clearPriorityQueue() {
-	while (qPNormal.size() > 0) {
-		FluentLevel* fl = (FluentLevel*)qPNormal.poll();
-		delete fl;
-	}
+	qPNormal.clear();
 }
 
 void TemporalRPG::build(TState* state) {
@@ -60,10 +57,10 @@ void TemporalRPG::build(TState* state) {
 	}
 	float auxLevel;
 	while (qPNormal.size() > 0) {
-		FluentLevel* fl = (FluentLevel*)qPNormal.poll();
-		std::vector<SASAction*>& req = task->requirers[fl->variable][fl->value];
+		FluentLevel fl = qPNormal.poll();
+		std::vector<SASAction*>& req = task->requirers[fl.variable][fl.value];
 #ifdef DEBUG_TEMPORALRPG_ON
-		cout << "EXTR.: " << fl->toString(task) << ", " << req.size() << " requirers" << endl;
+		cout << "EXTR.: " << fl.toString(task) << ", " << req.size() << " requirers" << endl;
 #endif
 		for (unsigned int i = 0; i < req.size(); i++) {
 			SASAction* a = req[i];
@@ -73,7 +70,7 @@ void TemporalRPG::build(TState* state) {
 					bool applicable = true;
 					for (unsigned int j = 0; j < a->startCond.size(); j++) {
 						auxLevel = getFirstGenerationTime(a->startCond[j].var, a->startCond[j].value);
-						if (auxLevel < 0 || auxLevel > fl->level) {
+						if (auxLevel < 0 || auxLevel > fl.level) {
 							applicable = false;
 							break; // Non applicable
 						}
@@ -81,24 +78,24 @@ void TemporalRPG::build(TState* state) {
 					if (applicable) {
 						for (unsigned int j = 0; j < a->overCond.size(); j++) {
 							auxLevel = getFirstGenerationTime(a->overCond[j].var, a->overCond[j].value);
-							if (auxLevel < 0 || auxLevel > fl->level) {
+							if (auxLevel < 0 || auxLevel > fl.level) {
 								applicable = false;
 								break; // Non applicable
 							}
 						}
 						if (applicable) {
 #ifdef DEBUG_TEMPORALRPG_ON
-							cout << "N.ACTION " << fl->level << ": " << a->name << endl;
+							cout << "N.ACTION " << fl.level << ": " << a->name << endl;
 #endif
 							visitedAction[a->index] = 1;
-							float effLevel = fl->level + EPSILON;
+							float effLevel = fl.level + EPSILON;
 							for (unsigned j = 0; j < a->startEff.size(); j++) {
 								TVariable v = a->startEff[j].var;
 								TValue value = a->startEff[j].value;
 								auxLevel = getFirstGenerationTime(v, value);
 								if (auxLevel == -1 || auxLevel > effLevel) {
 									firstGenerationTime[SASTask::getVariableValueCode(v, value)] = effLevel;
-									qPNormal.add(new FluentLevel(v, value, effLevel));
+									qPNormal.emplace(v, value, effLevel);
 #ifdef DEBUG_TEMPORALRPG_ON
 									cout << "* PROG: (" << task->variables[v].name << "," << task->values[value].name << ") -> " << effLevel << endl;
 #endif
@@ -111,7 +108,7 @@ void TemporalRPG::build(TState* state) {
 								auxLevel = getFirstGenerationTime(v, value);
 								if (auxLevel == -1 || auxLevel > effLevel) {
 									firstGenerationTime[SASTask::getVariableValueCode(v, value)] = effLevel;
-									qPNormal.add(new FluentLevel(v, value, effLevel));
+									qPNormal.emplace(v, value, effLevel);
 #ifdef DEBUG_TEMPORALRPG_ON
 									cout << "* PROG: (" << task->variables[v].name << "," << task->values[value].name << ") -> " << effLevel << endl;
 #endif
@@ -126,18 +123,18 @@ void TemporalRPG::build(TState* state) {
 					bool applicable = true;
 					for (SASCondition& c: e.startCond) {
 						auxLevel = getFirstGenerationTime(c.var, c.value);
-						if (auxLevel < 0 || auxLevel > fl->level) {
+						if (auxLevel < 0 || auxLevel > fl.level) {
 							applicable = false;
 							break; // Non applicable
 						}
 					}
 					if (applicable) {
-						float effLevel = fl->level + EPSILON;
+						float effLevel = fl.level + EPSILON;
 						for (SASCondition &c : e.startEff) {
 							auxLevel = getFirstGenerationTime(c.var, c.value);
 							if (auxLevel == -1 || auxLevel > effLevel) {
 								firstGenerationTime[SASTask::getVariableValueCode(c.var, c.value)] = effLevel;
-								qPNormal.add(new FluentLevel(c.var, c.value, effLevel));
+								qPNormal.emplace(c.var, c.value, effLevel);
 							}
 						}
 						effLevel += task->getActionDuration(a, state->minState);
@@ -145,14 +142,13 @@ void TemporalRPG::build(TState* state) {
 							auxLevel = getFirstGenerationTime(c.var, c.value);
 							if (auxLevel == -1 || auxLevel > effLevel) {
 								firstGenerationTime[SASTask::getVariableValueCode(c.var, c.value)] = effLevel;
-								qPNormal.add(new FluentLevel(c.var, c.value, effLevel));
+								qPNormal.emplace(c.var, c.value, effLevel);
 							}
 						}
 					}
 				}
 			}
 		}
-		delete fl;
 		if (untilGoals && checkAcheivedGoals()) {
 			clearPriorityQueue();
 		}
@@ -208,7 +204,7 @@ void TemporalRPG::programAction(SASAction* a, TState* state) {
 			level = getFirstGenerationTime(v, value);
 			if (level == -1) {
 				firstGenerationTime[SASTask::getVariableValueCode(v, value)] = EPSILON;
-				qPNormal.add(new FluentLevel(v, value, EPSILON));
+				qPNormal.emplace(v, value, EPSILON);
 #ifdef DEBUG_TEMPORALRPG_ON
 				cout << "* PROG: (" << task->variables[v].name << "," << task->values[value].name << ") -> " << EPSILON << endl;
 #endif
@@ -230,7 +226,7 @@ void TemporalRPG::programAction(SASAction* a, TState* state) {
 					level = getFirstGenerationTime(c.var, c.value);
 					if (level == -1) {
 						firstGenerationTime[SASTask::getVariableValueCode(c.var, c.value)] = EPSILON;
-						qPNormal.add(new FluentLevel(c.var, c.value, EPSILON));
+						qPNormal.emplace(c.var, c.value, EPSILON);
 					}
 				}
 				for (SASCondition &c : e.endEff) {
@@ -238,7 +234,7 @@ void TemporalRPG::programAction(SASAction* a, TState* state) {
 					if (level == -1) {
 						if (duration < 0) duration = EPSILON + task->getActionDuration(a, state->minState);
 						firstGenerationTime[SASTask::getVariableValueCode(c.var, c.value)] = duration;
-						qPNormal.add(new FluentLevel(c.var, c.value, duration));
+						qPNormal.emplace(c.var, c.value, duration);
 					}
 				}
 			}
@@ -251,7 +247,7 @@ void TemporalRPG::programAction(SASAction* a, TState* state) {
 			if (level == -1) {
 				if (duration < 0) duration = EPSILON + task->getActionDuration(a, state->minState);
 				firstGenerationTime[SASTask::getVariableValueCode(v, value)] = duration;
-				qPNormal.add(new FluentLevel(v, value, duration));
+				qPNormal.emplace(v, value, duration);
 #ifdef DEBUG_TEMPORALRPG_ON
 				cout << "* PROG: (" << task->variables[v].name << "," << task->values[value].name << ") -> " << duration << endl;
 #endif
@@ -303,22 +299,21 @@ void TemporalRPG::computeLiteralLevels() {
 		TVariable v = fluentList[i].variable;
 		TValue value = fluentList[i].value;
 		fluentIndex[SASTask::getVariableValueCode(v, value)] = fluentList[i].index;
-		qPNormal.add(new FluentLevel(v, value, fluentList[i].level));
+		qPNormal.emplace(v, value, fluentList[i].level);
 	}
 	float currentLevel = -1;
 	int i = -1;
 	while (qPNormal.size() > 0) {
-		FluentLevel* fl = (FluentLevel*)qPNormal.poll();
-		if (fl->level > currentLevel) {
+		FluentLevel fl = qPNormal.poll();
+		if (fl.level > currentLevel) {
 #ifdef DEBUG_TEMPORALRPG_ON
-			cout << "Level: " << fl->level << endl;
+			cout << "Level: " << fl.level << endl;
 #endif
 			fluentLevels.emplace_back();
-			currentLevel = fl->level;
+			currentLevel = fl.level;
 			fluentLevelIndex[currentLevel] = ++i;
 		}
-		fluentLevels[i].push_back(SASTask::getVariableValueCode(fl->variable, fl->value));
-		delete fl;
+		fluentLevels[i].push_back(SASTask::getVariableValueCode(fl.variable, fl.value));
 	}
 }
 
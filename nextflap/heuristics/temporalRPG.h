@@ -14,7 +14,7 @@
 #include "../sas/sasTask.h"
 #include "../planner/state.h"
 
-class FluentLevel : public PriorityQueueItem {		// Level of a(sub)goal
+class FluentLevel {		// Level of a(sub)goal
 public:
 	TVariable variable;
 	TValue value;
@@ -24,17 +24,19 @@ public:
 		value = val;
 		level = lev;
 	}
-	virtual inline int compare(PriorityQueueItem* other) {
-		float otherLevel = ((FluentLevel*)other)->level;
-		if (level < otherLevel) return -1;
-		else if (level > otherLevel) return 1;
-		else return 0;
-	}
 	std::string toString(SASTask* task) {
 		return "(" + task->variables[variable].name + "," + task->values[value].name + ") -> " + std::to_string(level);
 	}
 };
 
+// Fluents with a lower level are extracted first
+class FluentLevelOrder {
+public:
+	inline bool operator()(const FluentLevel& f1, const FluentLevel& f2) const {
+		return f1.level < f2.level;
+	}
+};
+
 class LMFluent {	// Landmark literal
 public:
 	TVariable variable;
@@ -69,7 +71,7 @@ private:
 	SASTask* task;
 	int numActions;
 	std::unordered_map<TVarValue, float> firstGenerationTime;
-	PriorityQueue qPNormal;
+	PriorityQueue<FluentLevel, FluentLevelOrder> qPNormal;
 	bool untilGoals;
 	std::vector<TVarValue> goalsToAchieve;
 	bool verifyFluent;
@@ -44,12 +44,14 @@ SASTask* _sasTranslationStage(GroundedTask* gTask) {
     return sasTask;
 }
 
-// Planning process to search a solution plan
-std::string _startPlanning(SASTask* sTask, bool durativePlan) {
+// Planning process to search a solution plan. In anytime mode, the search goes on after each solution, pruning
+// the plans that are not better, and each improved plan is passed to the callback (if it is not None)
+std::string _startPlanning(SASTask* sTask, bool durativePlan, py::object& callback) {
     PlannerSetting planner(sTask);
     Plan* solution;
     float bestMakespan = FLOAT_INFINITY;
     int bestNumSteps = MAX_UINT16;
+    std::string bestPlan = "No plan";
     do {
         solution = planner.plan(bestMakespan, parsedTask);
         if (solution != nullptr) {
@@ -62,22 +64,27 @@ std::string _startPlanning(SASTask* sTask, bool durativePlan) {
                     (abs(solutionMakespan - bestMakespan) < EPSILON && solution->g < bestNumSteps)) {
                     bestMakespan = solutionMakespan;
                     bestNumSteps = solution->g;
-                    return PrintPlan::print(solution, &cvarValues, durativePlan);
+                    bestPlan = PrintPlan::print(solution, &cvarValues, durativePlan);
+                    if (!parsedTask->anytime)
+                        return bestPlan;
+                    if (!callback.is_none())
+                        callback(py::str(bestPlan));
                 }
             }
         }
     } while (solution != nullptr);
-    return "No plan";
+    return bestPlan;
 }
 
 // Preprocesses and solves the planning task
-std::string _solve(bool durativePlan) {
-    parsedTask->startTime = clock();
+std::string _solve(bool durativePlan, py::object& callback) {
+    parsedTask->startTime = std::chrono::steady_clock::now();
 
     PreprocessedTask* prepTask = nullptr;
     GroundedTask* gTask = nullptr;
     SASTask* sTask = nullptr;
     std::string res = "";
+    std::exception_ptr callbackError = nullptr;
     try {
         parsedTask->error = "";
         prepTask = _preprocessStage(parsedTask);
@@ -86,7 +93,7 @@ std::string _solve(bool durativePlan) {
             if (gTask != nullptr) {
                 sTask = _sasTranslationStage(gTask);
                 if (sTask != nullptr) {
-                    res = _startPlanning(sTask, durativePlan);
+                    res = _startPlanning(sTask, durativePlan, callback);
                 }
             }
         }
@@ -95,12 +102,19 @@ std::string _solve(bool durativePlan) {
         parsedTask->error = std::string(e.what());
         res = "Error: " + parsedTask->error;
     }
+    catch (const py::error_already_set&) {
+        // Raised by the callback in anytime mode. The search has already been stopped and its memory released,
+        // so the error is raised again once the task is freed
+        callbackError = std::current_exception();
+    }
     try {
         if (sTask != nullptr) delete sTask;
         if (gTask != nullptr) delete gTask;
         if (prepTask != nullptr) delete prepTask;
     }
     catch (...) {}
+    if (callbackError != nullptr)
+        std::rethrow_exception(callbackError);
     return res;
 }
 
@@ -110,15 +124,32 @@ void end_task() {
         delete parsedTask;
     }
     parsedTask = nullptr;
+    Arena::releaseAll();
 }
 
 // Creates a new planning task
-void start_task(py::float_ timeout) {
+void start_task(py::float_ timeout, py::int_ threads, py::bool_ distributed, py::int_ expansion_threads,
+    py::bool_ fifo_tie_breaking, py::bool_ multi_queue,
+    py::bool_ lazy_evaluation, py::bool_ anytime, py::int_ memory_limit) {
     if (parsedTask != nullptr) {
         end_task();
     }
     parsedTask = new ParsedTask();
     parsedTask->timeout = timeout;
+    parsedTask->numThreads = (int)threads > 1 ? (int)threads : 1;
+    parsedTask->distributedSearch = distributed;
+    parsedTask->expansionThreads = (int)expansion_threads > 1 ? (int)expansion_threads : 1;
+    parsedTask->fifoTieBreaking = fifo_tie_breaking;
+    parsedTask->multiQueue = multi_queue;
+    parsedTask->lazyEvaluation = lazy_evaluation;
+    parsedTask->anytime = anytime;
+    parsedTask->memoryLimit = (long long)memory_limit > 0 ? (size_t)(long long)memory_limit * 1048576 : 0;
+    if (parsedTask->memoryLimit > 0 && parsedTask->distributedSearch && parsedTask->numThreads > 1) {
+        // The distributed search cannot evict plans, as their parents can be owned by other search threads
+        parsedTask->memoryLimit = 0;
+        if (PyErr_WarnEx(PyExc_UserWarning, "NextFLAP: memory_limit is ignored in the distributed search.", 1) < 0)
+            throw py::error_already_set();
+    }
     parsedTask->setDomainName("UPF");
     //createDebugFile();
 }
@@ -927,15 +958,20 @@ py::bool_ add_goal(py::list cond) {
     return _to_precondition(cond, parsedTask->goal, &variables, nullptr);
 }
 
-// Solves the planning task and returns the plan as a string
-py::str solve(py::bool_ durativePlan) {
-    return py::str(_solve(durativePlan));
+// Solves the planning task and returns the plan as a string. In anytime mode, the improved plans found during the
+// search are also passed to the callback function
+py::str solve(py::bool_ durativePlan, py::object callback) {
+    return py::str(_solve(durativePlan, callback));
 }
 
 PYBIND11_MODULE(nextflap, m) {
     m.doc() = "pybind11 nextflap plugin"; // optional module docstring
 
-    m.def("start_task", &start_task, "A function that creates the PDDL task");
+    m.def("start_task", &start_task, "A function that creates the PDDL task",
+        py::arg("timeout"), py::arg("threads") = 1, py::arg("distributed") = false,
+        py::arg("expansion_threads") = 1, py::arg("fifo_tie_breaking") = true,
+        py::arg("multi_queue") = false, py::arg("lazy_evaluation") = false,
+        py::arg("anytime") = false, py::arg("memory_limit") = 0);
     m.def("end_task", &end_task, "A function that finishes the PDDL task");
     m.def("get_error", &get_error, "A function that gets information about the last error");
     m.def("add_type", &add_type, "A function that adds a PDDL type to the task");
@@ -944,6 +980,6 @@ PYBIND11_MODULE(nextflap, m) {
     m.def("add_action", &add_action, "A function that adds a PDDL action to the task");
     m.def("add_initial_value", &add_initial_value, "A function that adds the initial value of a fluent to the task");
     m.def("add_goal", &add_goal, "A function that adds the goal to the task");
-    m.def("solve", &solve, "Solve the planning task");
+    m.def("solve", &solve, "Solve the planning task", py::arg("durativePlan"), py::arg("callback") = py::none());
 }
 
@@ -1050,7 +1050,8 @@ string ParsedTask::toString() {
 
 float ParsedTask::ellapsedTime()
 {
-    return toSeconds(startTime);
+    std::chrono::duration<float> t = std::chrono::steady_clock::now() - startTime;
+    return t.count();
 }
 
 // Checks if one of the types is compatible with one of the valid ones
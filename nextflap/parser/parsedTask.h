@@ -3,7 +3,7 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
-#include <time.h>
+#include <chrono>
 #include "syntaxAnalyzer.h"
 
 /********************************************************/
@@ -390,7 +390,15 @@ public:
     int parallelLength;
     std::string error;
     float timeout = -1.0f;
-    clock_t startTime;
+    unsigned int numThreads = 1;                            // Number of search threads
+    bool distributedSearch = false;                         // Parallel search: hash-distributed (true) or portfolio (false)
+    unsigned int expansionThreads = 1;                      // Number of threads to compute the successors of a plan
+    bool fifoTieBreaking = true;                            // Order of the open plans with the same evaluation (FIFO or LIFO)
+    bool multiQueue = false;                                // Alternate open lists for h, hLand and preferred plans
+    bool lazyEvaluation = false;                            // Evaluate the plans when they are selected for expansion
+    bool anytime = false;                                   // Keep searching for better plans after the first one
+    size_t memoryLimit = 0;                                 // Memory (bytes) for the plans of each search thread (0: unlimited)
+    std::chrono::steady_clock::time_point startTime;       // Wall-clock time (CPU time grows with the number of threads)
 
     void setDomainName(std::string name);
     void setError(std::string e);
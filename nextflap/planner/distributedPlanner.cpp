@@ -0,0 +1,216 @@
+#include <thread>
+#include <chrono>
+#include "distributedPlanner.h"
+#include "z3Checker.h"
+#include "printPlan.h"
+
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Hash-distributed parallel search (HDA*). Each plan   */
+/* is assigned to a search thread according to the hash */
+/* code of its frontier state. The search has no memory */
+/* limit, as the plans cannot be evicted from the tree  */
+/* while other threads expand their descendants.        */
+/********************************************************/
+
+using namespace std;
+
+#define IDLE_YIELDS		16		// Empty polls before an idle worker starts to sleep
+#define MAX_IDLE_PAUSE	512		// Maximum sleep (in microseconds) of an idle worker
+
+/********************************************************/
+/* CLASS: DistributedWorker                             */
+/********************************************************/
+
+DistributedWorker::DistributedWorker(SASTask* task, TState* initialState, bool forceAtEndConditions,
+	bool filterRepeatedStates, std::vector<SASAction*>* tilActions, ParsedTask* parsedTask,
+	StateRegistry* stateRegistry)
+{
+	successors = new Successors(initialState, task, forceAtEndConditions, filterRepeatedStates, tilActions, stateRegistry);
+	successors->sharedSearchTree = true;
+	successors->setExpansionThreads(parsedTask->expansionThreads);
+	successors->lazyEvaluation = parsedTask->lazyEvaluation;
+	checker = new Z3Checker(successors->getPlanComponents());
+	selector = new PlanSelector(0, parsedTask->fifoTieBreaking, parsedTask->multiQueue,
+		successors->evaluator.informativeLandmarks());
+	successors->preferredOperators = selector->usesPreferredPlans();
+}
+
+DistributedWorker::~DistributedWorker()
+{
+	delete checker;
+	delete successors;
+	delete selector;
+}
+
+/********************************************************/
+/* CLASS: DistributedPlanner                            */
+/********************************************************/
+
+// Constructor. The workers are created sequentially, as the evaluator initialization is not thread-safe
+DistributedPlanner::DistributedPlanner(SASTask* task, Plan* initialPlan, TState* initialState, bool forceAtEndConditions,
+	bool filterRepeatedStates, std::vector<SASAction*>* tilActions, ParsedTask* parsedTask, unsigned int numThreads,
+	StateRegistry* stateRegistry)
+{
+	this->parsedTask = parsedTask;
+	this->solution = nullptr;
+	this->bestMakespan = FLOAT_INFINITY;
+	for (unsigned int i = 0; i < numThreads; i++)
+		workers.push_back(new DistributedWorker(task, initialState, forceAtEndConditions, filterRepeatedStates, tilActions,
+			parsedTask, stateRegistry));
+	Successors* successors = workers[0]->successors;
+	successors->evaluator.calculateFrontierState(initialPlan);
+	successors->evaluator.evaluateInitialPlan(initialPlan);
+	openPlans = 0;
+	addPlan(workers[getOwner(initialPlan)], initialPlan);
+}
+
+DistributedPlanner::~DistributedPlanner()
+{
+	for (DistributedWorker* w : workers)
+		delete w;
+}
+
+// Starts the search
+Plan* DistributedPlanner::plan(float bestMakespan)
+{
+	this->bestMakespan = bestMakespan;
+	stopSearch = false;
+	searchError = nullptr;
+	vector<thread> threads;
+	for (unsigned int i = 0; i < workers.size(); i++)
+		threads.emplace_back(&DistributedPlanner::search, this, i);
+	for (thread& t : threads)
+		t.join();
+	if (debugFile != nullptr) {
+		uint64_t hits = 0, misses = 0;
+		for (DistributedWorker* w : workers) {
+			hits += w->successors->evaluator.getCacheHits();
+			misses += w->successors->evaluator.getCacheMisses();
+		}
+		*debugFile << ";Heuristic cache: " << hits << " hits, " << misses << " misses" << endl;
+	}
+	if (searchError != nullptr)
+		rethrow_exception(searchError);
+	return solution;
+}
+
+// Clears the last solution found
+void DistributedPlanner::clearSolution()
+{
+	solution = nullptr;
+	for (DistributedWorker* w : workers)
+		w->successors->solution = nullptr;
+}
+
+// Checks if a plan is valid. The plan components and the validator of the worker are reused. The check can
+// reschedule the plan, so only the plans that other workers cannot read are checked: the ones owned by this
+// worker and its solution plan, which is never sent
+bool DistributedPlanner::checkPlan(Plan* p, unsigned int index) {
+	DistributedWorker* w = workers[index];
+	if (p != w->successors->solution && getOwner(p) != index)
+		throwError("Plan " + to_string(p->id) + " is not owned by search thread " + to_string(index));
+	p->z3Checked = true;
+	return w->checker->checkPlan(p, false);
+}
+
+// Search loop of a worker. It finishes when a solution is found or there are no plans left in any worker
+void DistributedPlanner::search(unsigned int index)
+{
+	DistributedWorker* w = workers[index];
+	Plan* p;
+	unsigned int idlePolls = 0;
+	try {
+		while (!stopSearch.load(memory_order_relaxed)) {
+			if (parsedTask->timeout > 0 && parsedTask->ellapsedTime() > parsedTask->timeout) {
+				stopSearch = true;
+				break;
+			}
+			while (w->inbox.pop(p)) {
+				addPlan(w, p);
+				openPlans.fetch_sub(1, memory_order_acq_rel);	// Counted in the open lists from now on
+			}
+			if (w->selector->size() > 0) {
+				idlePolls = 0;
+				int size = w->selector->size();
+				Plan* base = w->selector->poll();		// nullptr if only already expanded plans were left
+				size -= w->selector->size();			// Removed from the open lists
+				if (base != nullptr) searchStep(index, base);
+				openPlans.fetch_sub(size, memory_order_acq_rel);
+			}
+			else if (openPlans.load(memory_order_acquire) == 0) break;
+			else if (++idlePolls <= IDLE_YIELDS) this_thread::yield();
+			else {	// Exponential backoff while other workers generate plans
+				unsigned int shift = min(idlePolls - IDLE_YIELDS, 9u);
+				this_thread::sleep_for(chrono::microseconds(min(1u << shift, (unsigned int)MAX_IDLE_PAUSE)));
+			}
+		}
+	}
+	catch (...) {
+		lock_guard<mutex> lock(solutionMutex);
+		if (searchError == nullptr)
+			searchError = current_exception();
+		stopSearch = true;
+	}
+}
+
+// Expands one plan of the worker. The invalid plans are discarded without checking their ancestors,
+// as these can be being expanded by other workers
+void DistributedPlanner::searchStep(unsigned int index, Plan* base)
+{
+	Successors* successors = workers[index]->successors;
+	vector<Plan*>& sucPlans = workers[index]->sucPlans;
+	if (base->invalid || successors->repeatedState(base))
+		return;
+	if (bestMakespan < FLOAT_INFINITY && PrintPlan::getMakespan(base) > bestMakespan)
+		return;		// Worse than the last solution found (anytime search)
+	if (base->pendingEvaluation) {	// Lazy evaluation. The frontier state is calculated again to trace the landmarks
+		successors->evaluator.calculateFrontierState(base);
+		successors->evaluator.evaluate(base);
+		base->pendingEvaluation = false;
+		if (base->h >= MAX_UINT16) return;	// Dead end
+	}
+	if (base->action->startNumCond.size() > 0 ||
+		base->action->overNumCond.size() > 0 ||
+		base->action->endNumCond.size() > 0) {
+		if (base->h <= 1 && !checkPlan(base, index)) {	// Validity checking
+			base->invalid = true;	// It can still be stored in other open lists of the worker
+			return;
+		}
+	}
+	successors->computeSuccessors(base, &sucPlans, bestMakespan);
+	if (successors->solution != nullptr) {
+		if (checkPlan(successors->solution, index)) {
+			lock_guard<mutex> lock(solutionMutex);
+			if (solution == nullptr) {
+				solution = successors->solution;
+				stopSearch = true;
+			}
+		}
+		else successors->solution = nullptr;
+	}
+	base->addChildren(sucPlans);
+	for (Plan* p : sucPlans)
+		sendPlan(index, p);
+}
+
+// Sends a new plan to the worker that owns its frontier state
+void DistributedPlanner::sendPlan(unsigned int from, Plan* p)
+{
+	unsigned int owner = getOwner(p);
+	if (owner == from) addPlan(workers[owner], p);
+	else {
+		openPlans.fetch_add(1, memory_order_acq_rel);
+		workers[owner]->inbox.push(p);
+	}
+}
+
+// Adds a plan to the open lists of a worker. It is counted once for each list that stores it
+void DistributedPlanner::addPlan(DistributedWorker* w, Plan* p)
+{
+	int size = w->selector->size();
+	w->selector->add(p);
+	openPlans.fetch_add(w->selector->size() - size, memory_order_acq_rel);
+}
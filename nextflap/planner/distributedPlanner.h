@@ -0,0 +1,75 @@
+#ifndef DISTRIBUTED_PLANNER_H
+#define DISTRIBUTED_PLANNER_H
+
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Hash-distributed parallel search (HDA*). Each plan   */
+/* is assigned to a search thread according to the hash */
+/* code of its frontier state. The search has no memory */
+/* limit, as the plans cannot be evicted from the tree  */
+/* while other threads expand their descendants.        */
+/********************************************************/
+
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include "../parser/parsedTask.h"
+#include "../sas/sasTask.h"
+#include "../utils/mpscQueue.h"
+#include "state.h"
+#include "stateRegistry.h"
+#include "plan.h"
+#include "successors.h"
+#include "selector.h"
+
+class Z3Checker;
+
+// Search thread. It owns the plans whose frontier state is assigned to it, and the plans it generates until they are sent
+class DistributedWorker {
+public:
+	Successors* successors;				// Its visitedStates bit vector (indexed by state id) is the duplicate table of the states owned by this worker
+	Z3Checker* checker;					// Plan validator of this worker
+	PlanSelector* selector;				// Local open lists
+	MPSCQueue<Plan*> inbox;				// Plans generated by other workers and assigned to this one
+	std::vector<Plan*> sucPlans;
+
+	DistributedWorker(SASTask* task, TState* initialState, bool forceAtEndConditions,
+		bool filterRepeatedStates, std::vector<SASAction*>* tilActions, ParsedTask* parsedTask,
+		StateRegistry* stateRegistry);
+	~DistributedWorker();
+};
+
+class DistributedPlanner {
+private:
+	ParsedTask* parsedTask;
+	std::vector<DistributedWorker*> workers;
+	std::atomic<bool> stopSearch;
+	std::atomic<int> openPlans;			// Plans in the inboxes or in the open lists (once per list), or being expanded
+	std::mutex solutionMutex;
+	std::exception_ptr searchError;
+	Plan* solution;
+	float bestMakespan;
+
+	inline unsigned int getOwner(Plan* p) {		// Repeated states have the same id, so they go to the same worker
+		uint64_t code = p->stateId;
+		code = (code ^ (code >> 33)) * 0xff51afd7ed558ccdULL;
+		return (unsigned int)((code ^ (code >> 33)) % workers.size());
+	}
+	void search(unsigned int index);
+	void searchStep(unsigned int index, Plan* base);
+	void sendPlan(unsigned int from, Plan* p);
+	void addPlan(DistributedWorker* w, Plan* p);
+	bool checkPlan(Plan* p, unsigned int index);
+
+public:
+	DistributedPlanner(SASTask* task, Plan* initialPlan, TState* initialState, bool forceAtEndConditions,
+		bool filterRepeatedStates, std::vector<SASAction*>* tilActions, ParsedTask* parsedTask,
+		unsigned int numThreads, StateRegistry* stateRegistry);
+	~DistributedPlanner();
+	Plan* plan(float bestMakespan);
+	void clearSolution();
+};
+
+#endif
@@ -275,14 +275,14 @@ void IntervalCalculations::applyStartEffects(Plan* p, bool* holdCondEff)
 {
 	for (SASNumericEffect& e : a->startNumEff) {
 		applyEffect(&e);
-		p->startPoint.addNumericValue(e.var, fluentValues[e.var].minValue, fluentValues[e.var].maxValue);
+		p->addNumericValue(true, e.var, fluentValues[e.var].minValue, fluentValues[e.var].maxValue);
 	}
 	if (holdCondEff != nullptr) {
 		for (unsigned int i = 0; i < a->conditionalEff.size(); i++) {
 			if (holdCondEff[i]) {
 				for (SASNumericEffect& e : a->conditionalEff[i].startNumEff) {
 					applyEffect(&e);
-					p->startPoint.addNumericValue(e.var, fluentValues[e.var].minValue, fluentValues[e.var].maxValue);
+					p->addNumericValue(true, e.var, fluentValues[e.var].minValue, fluentValues[e.var].maxValue);
 				}
 			}
 		}
@@ -315,14 +315,14 @@ void IntervalCalculations::applyEndEffects(Plan* p, bool* holdCondEff)
 {
 	for (SASNumericEffect& e : a->endNumEff) {
 		applyEffect(&e);
-		p->endPoint.addNumericValue(e.var, fluentValues[e.var].minValue, fluentValues[e.var].maxValue);
+		p->addNumericValue(false, e.var, fluentValues[e.var].minValue, fluentValues[e.var].maxValue);
 	}
 	if (holdCondEff != nullptr) {
 		for (unsigned int i = 0; i < a->conditionalEff.size(); i++) {
 			if (holdCondEff[i]) {
 				for (SASNumericEffect& e : a->conditionalEff[i].endNumEff) {
 					applyEffect(&e);
-					p->endPoint.addNumericValue(e.var, fluentValues[e.var].minValue, fluentValues[e.var].maxValue);
+					p->addNumericValue(false, e.var, fluentValues[e.var].minValue, fluentValues[e.var].maxValue);
 				}
 			}
 		}
@@ -353,12 +353,9 @@ void IntervalCalculations::applyEndEffects(std::vector<TNumVarChange>* v, bool*
 // Makes a backup of the control parameter intervals
 void IntervalCalculations::copyControlVars(Plan* p)
 {
-	if (cvarValues.empty()) return;
-	p->cvarValues = new std::vector<TInterval>();
 	for (TInterval& i : cvarValues) {
-		p->cvarValues->push_back(i);
+		p->addControlVarValue(i);
 	}
-	p->cvarValues->shrink_to_fit();
 }
 
 // Makes a backup of the duration interval
@@ -14,6 +14,7 @@
 // Base class for numeric interval
 class FluentIntervalData {
 public:
+    virtual ~FluentIntervalData() { }
     virtual TFloatValue getMinValue(TVariable v, int numState) = 0;
     virtual TFloatValue getMaxValue(TVariable v, int numState) = 0;
 };
@@ -13,17 +13,17 @@ void Linearizer::linearize(PlanComponents& planComponents)
 	unsigned int numActions = planComponents.size();
 	linearOrder.clear();
 	linearOrder.reserve(((size_t)numActions) << 1);
-	PriorityQueue timePoints((unsigned int)linearOrder.capacity());
+	timePoints.clear();
 	TTimePoint p = 0;
 	for (unsigned int i = 0; i < numActions; i++) {
-		Plan* comp = planComponents.get(i);
-		timePoints.add(new ScheduledTimepoint(p++, comp->startPoint.updatedTime));
-		timePoints.add(new ScheduledTimepoint(p++, comp->endPoint.updatedTime));
+		timePoints.emplace(p, planComponents.getTime(p));
+		p++;
+		timePoints.emplace(p, planComponents.getTime(p));
+		p++;
 	}
 	while (timePoints.size() > 0) {
-		ScheduledTimepoint* tp = (ScheduledTimepoint*)timePoints.poll();
-		linearOrder.push_back(tp->point);
-		//cout << tp->point << " [" << tp->scheduledTime << "]" << endl;
-		delete tp;
+		ScheduledTimepoint tp = timePoints.poll();
+		linearOrder.push_back(tp.point);
+		//cout << tp.point << " [" << tp.scheduledTime << "]" << endl;
 	}
 }
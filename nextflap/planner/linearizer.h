@@ -14,7 +14,7 @@
 #include "../utils/priorityQueue.h"
 #include "planComponents.h"
 
-class ScheduledTimepoint : public PriorityQueueItem {
+class ScheduledTimepoint {
 public:
 	TTimePoint point;
 	float scheduledTime;
@@ -22,18 +22,20 @@ public:
 		point = p;
 		scheduledTime = time;
 	}
-	inline int compare(PriorityQueueItem* other) {
-		float otherTime = ((ScheduledTimepoint*)other)->scheduledTime;
-		if (scheduledTime < otherTime) return -1;
-		else if (scheduledTime > otherTime) return 1;
-		else return 0;
+};
+
+// Earlier timepoints are sorted first
+class ScheduledTimepointOrder {
+public:
+	inline bool operator()(const ScheduledTimepoint& t1, const ScheduledTimepoint& t2) const {
+		return t1.scheduledTime < t2.scheduledTime;
 	}
-	virtual ~ScheduledTimepoint() { }
 };
 
 class Linearizer {
 public:
 	std::vector<TTimePoint> linearOrder;
+	PriorityQueue<ScheduledTimepoint, ScheduledTimepointOrder> timePoints;
 
 	void linearize(PlanComponents& planComponents);
 };
@@ -0,0 +1,121 @@
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Order relationships among the time points of a plan, */
+/* stored as a dense bit-matrix.                        */
+/********************************************************/
+
+#include "orderMatrix.h"
+using namespace std;
+
+/********************************************************/
+/* CLASS: OrderMatrix                                   */
+/********************************************************/
+
+OrderMatrix::OrderMatrix()
+{
+	numPoints = 0;
+	numWords = 0;
+	resize(INITIAL_MATRIX_POINTS);
+}
+
+// Makes the matrix larger. The matrix is cleared, so the components must be applied again
+void OrderMatrix::resize(unsigned int size)
+{
+	unsigned int newPoints = numPoints == 0 ? INITIAL_MATRIX_POINTS : numPoints;
+	while (newPoints < size) newPoints <<= 1;
+	numPoints = newPoints;
+	numWords = numPoints >> 6;
+	bits.assign((size_t)numPoints * numWords, 0);
+	closure.resize(numWords);
+	levels.clear();
+	levelIds.clear();
+	levelEnd.clear();
+	log.clear();
+}
+
+// Removes the orderings of the components after the first numLevels ones
+void OrderMatrix::undo(unsigned int numLevels)
+{
+	unsigned int logSize = numLevels == 0 ? 0 : levelEnd[numLevels - 1];
+	while (log.size() > logSize) {
+		TOrdering o = log.back();
+		log.pop_back();
+		clearOrder(firstPoint(o), secondPoint(o));
+	}
+	levels.resize(numLevels);
+	levelIds.resize(numLevels);
+	levelEnd.resize(numLevels);
+}
+
+// Adds the orderings of a plan component
+void OrderMatrix::apply(Plan* p, TStep step)
+{
+	if (p->action != nullptr)
+		addOrder(stepToStartPoint(step), stepToEndPoint(step));	// Start point of the step always before the end point of the step
+	for (TOrdering o : p->getOrderings())						// Plan orderings
+		addOrder(firstPoint(o), secondPoint(o));
+	if (step > 0) {
+		addOrder(1, stepToStartPoint(step));					// Orderings with the initial step
+		addOrder(1, stepToEndPoint(step));
+	}
+	levels.push_back(p);
+	levelIds.push_back(p->id);
+	levelEnd.push_back((unsigned int)log.size());
+}
+
+// Computes the order relationships of the given plan. Only the components that
+// differ from the previously computed plan are applied
+void OrderMatrix::update(PlanComponents& planComponents)
+{
+	TStep numSteps = planComponents.size();
+	TTimePoint lastPoint = stepToEndPoint(numSteps);
+	if (lastPoint >= numPoints) resize(lastPoint + 1);
+	unsigned int common = 0;
+	while (common < levels.size() && common < numSteps && levels[common] == planComponents.get(common) &&
+		levelIds[common] == planComponents.get(common)->id)
+		common++;
+	undo(common);
+	for (TStep i = common; i < numSteps; i++)
+		apply(planComponents.get(i), i);
+	addOrder(lastPoint - 1, lastPoint);		// The same for the new step to be added (undone in the next update)
+}
+
+// Adds the ordering p1 -> p2 and the ones obtained by transitivity (every point before p1, or p1, goes
+// before p2 and every point after p2). The new orderings are appended to the given vector and their number
+// is returned
+unsigned int OrderMatrix::addOrderings(TTimePoint p1, TTimePoint p2, TTimePoint lastPoint,
+	std::vector<TTimePoint>& prevPoints, std::vector<TOrdering>& orderings)
+{
+	unsigned int words = (lastPoint >> 6) + 1, newOrderings = 0;
+	prevPoints.clear();
+	prevPoints.push_back(p1);
+	for (TTimePoint t = 1; t <= lastPoint; t++) {
+		if (existOrder(t, p1)) prevPoints.push_back(t);
+	}
+	uint64_t* next = row(p2);
+	for (unsigned int w = 0; w < words; w++) closure[w] = next[w];
+	closure[0] &= ~((uint64_t)1);									// Time points start at 1
+	if ((lastPoint & 63) != 63) closure[words - 1] &= (((uint64_t)1) << ((lastPoint & 63) + 1)) - 1;
+	for (TTimePoint prev : prevPoints) {
+		if (prev != p2 && !existOrder(prev, p2)) {
+			setOrder(prev, p2);
+			orderings.push_back(getOrdering(prev, p2));
+			newOrderings++;
+		}
+		uint64_t* r = row(prev);
+		for (unsigned int w = 0; w < words; w++) {
+			uint64_t added = closure[w] & ~r[w];
+			if ((prev >> 6) == w) added &= ~(((uint64_t)1) << (prev & 63));
+			r[w] |= added;
+			while (added != 0) {
+				TTimePoint t = (TTimePoint)((w << 6) + std::countr_zero(added));
+				orderings.push_back(getOrdering(prev, t));
+				newOrderings++;
+				added &= added - 1;
+			}
+		}
+	}
+	return newOrderings;
+}
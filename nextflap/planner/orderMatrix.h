@@ -0,0 +1,62 @@
+#ifndef ORDER_MATRIX_H
+#define ORDER_MATRIX_H
+
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Order relationships among the time points of a plan, */
+/* stored as a dense bit-matrix (one row of 64-bit      */
+/* words per time point). The matrix is updated         */
+/* incrementally: the orderings of each plan component  */
+/* are logged, so moving to another base plan only      */
+/* undoes the steps that are not shared with the        */
+/* previous one.                                        */
+/********************************************************/
+
+#include <bit>
+#include "../utils/utils.h"
+#include "plan.h"
+#include "planComponents.h"
+
+#define INITIAL_MATRIX_POINTS	512		// Initial number of rows (time points)
+
+class OrderMatrix {
+private:
+	unsigned int numPoints;						// Number of rows (multiple of 64)
+	unsigned int numWords;						// 64-bit words per row
+	std::vector<uint64_t> bits;					// Row t1 contains the time points t2 such that t1 -> t2
+	std::vector<Plan*> levels;					// Plan components currently applied to the matrix
+	std::vector<TPlanId> levelIds;				// Ids of those components (to detect reused memory)
+	std::vector<unsigned int> levelEnd;			// Size of the log after applying each component
+	std::vector<TOrdering> log;					// Orderings set by each component, in order
+	std::vector<uint64_t> closure;				// For internal calculations
+
+	void resize(unsigned int size);
+	void undo(unsigned int numLevels);
+	void apply(Plan* p, TStep step);
+	inline void addOrder(TTimePoint t1, TTimePoint t2) {
+		if (!existOrder(t1, t2)) {
+			setOrder(t1, t2);
+			log.push_back(getOrdering(t1, t2));
+		}
+	}
+
+public:
+	OrderMatrix();
+	void update(PlanComponents& planComponents);
+	unsigned int addOrderings(TTimePoint p1, TTimePoint p2, TTimePoint lastPoint, std::vector<TTimePoint>& prevPoints,
+		std::vector<TOrdering>& orderings);
+	inline uint64_t* row(TTimePoint t) { return &bits[(size_t)t * numWords]; }
+	inline bool existOrder(TTimePoint t1, TTimePoint t2) {
+		return (bits[(size_t)t1 * numWords + (t2 >> 6)] >> (t2 & 63)) & 1;
+	}
+	inline void setOrder(TTimePoint t1, TTimePoint t2) {
+		bits[(size_t)t1 * numWords + (t2 >> 6)] |= ((uint64_t)1) << (t2 & 63);
+	}
+	inline void clearOrder(TTimePoint t1, TTimePoint t2) {
+		bits[(size_t)t1 * numWords + (t2 >> 6)] &= ~(((uint64_t)1) << (t2 & 63));
+	}
+};
+
+#endif
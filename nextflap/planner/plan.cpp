@@ -6,18 +6,64 @@
 /********************************************************/
 
 #include "plan.h"
+#include <cstring>
 using namespace std;
 
+/********************************************************/
+/* CLASS: PlanBuffer                                    */
+/********************************************************/
+
+// Data of the plan being built by the current thread. Only one plan can be built at a time in each thread, from
+// its construction until compact() is called
+class PlanBuffer {
+public:
+	Plan* owner;					// Plan being built (nullptr if the buffer is not in use)
+	unsigned int ownerGeneration;	// Arena generation of the owner (its memory is released in later generations)
+	std::vector<TOrdering> orderings;
+	std::vector<TCausalLink> causalLinks[2];
+	std::vector<TNumericCausalLink> numCausalLinks[2];
+	std::vector<TFluentInterval> numVarValues[2];
+	std::vector<TInterval> cvarValues;
+	std::vector<int> condEffects;
+
+	PlanBuffer() { owner = nullptr; ownerGeneration = 0; }
+	inline bool inUse() { return owner != nullptr && ownerGeneration == Arena::getGeneration(); }
+	void clear() {
+		owner = nullptr;
+		orderings.clear();
+		cvarValues.clear();
+		condEffects.clear();
+		for (unsigned int i = 0; i < 2; i++) {
+			causalLinks[i].clear();
+			numCausalLinks[i].clear();
+			numVarValues[i].clear();
+		}
+	}
+};
+
+static thread_local PlanBuffer planBuffer;
+
+// The arrays are stored one after another in the data block, so the size of each item must keep the alignment
+// of the next array
+template <typename T>
+constexpr bool isPackedPlanItem() { return alignof(T) <= alignof(int) && sizeof(T) % alignof(int) == 0; }
+static_assert(isPackedPlanItem<TOrdering>() && isPackedPlanItem<TCausalLink>() &&
+	isPackedPlanItem<TNumericCausalLink>() && isPackedPlanItem<TFluentInterval>() && isPackedPlanItem<TInterval>() &&
+	isPackedPlanItem<int>(), "Plan data items must be packed without padding between arrays");
+
 /********************************************************/
 /* CLASS: Plan                                          */
 /********************************************************/
 
+const unsigned int Plan::ARRAY_ITEM_SIZE[PA_NUM_ARRAYS] = { sizeof(TOrdering), sizeof(TCausalLink),
+	sizeof(TCausalLink), sizeof(TNumericCausalLink), sizeof(TNumericCausalLink), sizeof(TFluentInterval),
+	sizeof(TFluentInterval), sizeof(TInterval), sizeof(int) };
+
 Plan::Plan(SASAction* action, Plan* parentPlan, TPlanId idPlan, bool* holdCondEff) {
 	this->parentPlan = parentPlan;
 	this->action = action;
 	this->childPlans = nullptr;
 	this->id = idPlan;
-	this->cvarValues = nullptr;
 	this->planUpdates = nullptr;
 	this->fixedInit = false;
 	if (parentPlan != nullptr) this->g = parentPlan->g + 1;
@@ -25,10 +71,23 @@ Plan::Plan(SASAction* action, Plan* parentPlan, TPlanId idPlan, bool* holdCondEf
 	this->h = (int)MAX_UINT16;
 	this->hLand = 0;
 	this->repeatedState = false;
-	this->fs = nullptr;
+	this->stateId = NO_STATE;
 	z3Checked = false;
 	invalid = false;
-	this->holdCondEff = nullptr; 
+	preferred = false;
+	evicted = false;
+	pendingEvaluation = false;
+	openLists = 0;
+	timesVersion = 0;
+	generation = Arena::getGeneration();
+	data = nullptr;
+	for (unsigned int i = 0; i < PA_NUM_ARRAYS; i++)
+		arraySize[i] = 0;
+	if (planBuffer.inUse())
+		throwError("Plan " + to_string(idPlan) + " created before compacting plan " + to_string(planBuffer.owner->id));
+	planBuffer.clear();
+	planBuffer.owner = this;
+	planBuffer.ownerGeneration = generation;
 	if (holdCondEff != nullptr) {
 		for (unsigned int i = 0; i < action->conditionalEff.size(); i++) {
 			if (holdCondEff[i]) {
@@ -40,27 +99,23 @@ Plan::Plan(SASAction* action, Plan* parentPlan, TPlanId idPlan, bool* holdCondEf
 
 Plan::~Plan()
 {
-	if (fs != nullptr) delete fs;
-	if (holdCondEff != nullptr) delete holdCondEff;
+	if (planBuffer.owner == this) planBuffer.clear();	// Discarded before being compacted
+	if (data != nullptr) Arena::deallocate(data, getArrayOffset(PA_NUM_ARRAYS), generation);
+	arenaDelete(childPlans, generation);
+	arenaDelete(planUpdates, generation);
 }
 
-void Plan::addFluentIntervals(PlanPoint& pp, std::vector<SASNumericEffect>& eff)
+void Plan::addFluentIntervals(bool atStart, std::vector<SASNumericEffect>& eff)
 {
-	if (eff.size() > 0) {
-		pp.numVarValues = new std::vector<TFluentInterval>();
-		for (int i = 0; i < eff.size(); i++) {
-			SASNumericEffect* ne = &(eff[i]);
-			pp.numVarValues->emplace_back(ne->var, ne->exp.value, ne->exp.value);
-		}
+	for (int i = 0; i < eff.size(); i++) {
+		SASNumericEffect* ne = &(eff[i]);
+		addNumericValue(atStart, ne->var, ne->exp.value, ne->exp.value);
 	}
 }
 
 void Plan::addConditionalEffect(unsigned int numEff)
 {
-	if (holdCondEff == nullptr) {
-		holdCondEff = new vector<int>();
-	}
-	holdCondEff->push_back(numEff);
+	planBuffer.condEffects.push_back(numEff);
 }
 
 void Plan::setDuration(TFloatValue min, TFloatValue max) {
@@ -74,24 +129,6 @@ void Plan::setTime(TTime init,  TTime end, bool fixed) {
 	this->endPoint.setInitialTime(end);
 }
 
-// Compares this plan with the given one. Returns a negative number if this is better, 
-// 0 if both are equally good or a positive number if p is better
-int Plan::compare(Plan* p)
-{
-	if (SIGNIFICATIVE_LANDMARKS) {
-		int v1 = g + h + 2 * hLand, v2 = p->g + p->h + 2 * p->hLand;
-		if (v1 < v2) return -1;
-		if (v1 > v2) return 1;
-		return 0;
-	}
-	else {
-		int v1 = g + 2 * h, v2 = p->g + 2 * p->h;
-		if (v1 < v2) return -1;
-		if (v1 > v2) return 1;
-		return 0;
-	}
-}
-
 bool Plan::isRoot()
 {
 	return parentPlan == nullptr || this->action->isTIL;
@@ -99,22 +136,42 @@ bool Plan::isRoot()
 
 void Plan::addFluentIntervals()
 {
-	addFluentIntervals(this->startPoint, this->action->startNumEff);
-	addFluentIntervals(this->endPoint, this->action->endNumEff);
+	addFluentIntervals(true, this->action->startNumEff);
+	addFluentIntervals(false, this->action->endNumEff);
 }
 
 void Plan::addChildren(std::vector<Plan*>& suc)
 {
-	childPlans = new std::vector<Plan*>(suc);
+	childPlans = arenaNew<ArenaVector<Plan*>>(suc.begin(), suc.end());
 }
 
 void Plan::addPlanUpdate(TTimePoint tp, TFloatValue time)
 {
 	if (planUpdates == nullptr)
-		planUpdates = new std::vector<TPlanUpdate>();
+		planUpdates = arenaNew<ArenaVector<TPlanUpdate>>();
 	planUpdates->emplace_back(tp, time);
 }
 
+// Approximated number of bytes used by the plan
+size_t Plan::getMemorySize()
+{
+	size_t size = sizeof(Plan) + getArrayOffset(PA_NUM_ARRAYS);
+	if (childPlans != nullptr) size += sizeof(ArenaVector<Plan*>) + childPlans->capacity() * sizeof(Plan*);
+	if (planUpdates != nullptr) size += sizeof(ArenaVector<TPlanUpdate>) + planUpdates->capacity() * sizeof(TPlanUpdate);
+	return size;
+}
+
+void Plan::removeChild(Plan* child)
+{
+	if (childPlans == nullptr) return;
+	for (unsigned int i = 0; i < childPlans->size(); i++) {
+		if ((*childPlans)[i] == child) {
+			childPlans->erase(childPlans->begin() + i);
+			break;
+		}
+	}
+}
+
 int Plan::getCheckDistance()
 {
 	if (z3Checked || parentPlan == nullptr) return 0;
@@ -129,25 +186,75 @@ int Plan::getH(int queue)
 }
 */
 
-void PlanPoint::addCausalLink(TTimePoint timePoint, TVarValue varVal)
+void Plan::addOrdering(TOrdering o)
 {
+	planBuffer.orderings.push_back(o);
+}
+
+void Plan::addCausalLink(bool atStart, TTimePoint timePoint, TVarValue varVal)
+{
+	std::vector<TCausalLink>& causalLinks = planBuffer.causalLinks[atStart ? 0 : 1];
 	for (TCausalLink& cl : causalLinks)
 		if (cl.varVal == varVal)
 			return; // Repeated causal link
 	causalLinks.emplace_back(timePoint, varVal);
 }
 
-void PlanPoint::addNumericCausalLink(TTimePoint timePoint, TVarValue var)
+void Plan::addNumericCausalLink(bool atStart, TTimePoint timePoint, TVariable var)
 {
+	std::vector<TNumericCausalLink>& numCausalLinks = planBuffer.numCausalLinks[atStart ? 0 : 1];
 	for (TNumericCausalLink& cl : numCausalLinks)
 		if (cl.var == var)
 			return; // Repeated causal link
 	numCausalLinks.emplace_back(timePoint, var);
 }
 
-void PlanPoint::addNumericValue(TVariable v, TFloatValue min, TFloatValue max)
+void Plan::addNumericValue(bool atStart, TVariable v, TFloatValue min, TFloatValue max)
 {
-	if (numVarValues == nullptr)
-		numVarValues = new std::vector<TFluentInterval>();
-	numVarValues->emplace_back(v, min, max);
+	planBuffer.numVarValues[atStart ? 0 : 1].emplace_back(v, min, max);
+}
+
+void Plan::addControlVarValue(TInterval& value)
+{
+	planBuffer.cvarValues.push_back(value);
+}
+
+// Copies an array of the buffer to the plan data block
+template <typename T>
+static inline char* copyPlanArray(std::vector<T>& v, char* dest, uint16_t* size)
+{
+	*size = (uint16_t)v.size();
+	if (!v.empty()) {
+		memcpy(dest, v.data(), v.size() * sizeof(T));
+		dest += v.size() * sizeof(T);
+	}
+	return dest;
+}
+
+// Moves the data of the plan being built to a single memory block in the search arena
+void Plan::compact()
+{
+	PlanBuffer& b = planBuffer;
+	if (b.owner != this)
+		throwError("Plan " + to_string(id) + " is not being built in this thread");
+	char* dest = nullptr;
+	size_t size = b.orderings.size() * sizeof(TOrdering) + b.cvarValues.size() * sizeof(TInterval) +
+		b.condEffects.size() * sizeof(int);
+	for (unsigned int i = 0; i < 2; i++)
+		size += b.causalLinks[i].size() * sizeof(TCausalLink) + b.numCausalLinks[i].size() * sizeof(TNumericCausalLink) +
+			b.numVarValues[i].size() * sizeof(TFluentInterval);
+	if (size > 0) {
+		data = (char*)Arena::allocate(size);
+		dest = data;
+	}
+	dest = copyPlanArray(b.orderings, dest, &arraySize[PA_ORDERINGS]);
+	dest = copyPlanArray(b.causalLinks[0], dest, &arraySize[PA_START_CAUSAL_LINKS]);
+	dest = copyPlanArray(b.causalLinks[1], dest, &arraySize[PA_END_CAUSAL_LINKS]);
+	dest = copyPlanArray(b.numCausalLinks[0], dest, &arraySize[PA_START_NUM_CAUSAL_LINKS]);
+	dest = copyPlanArray(b.numCausalLinks[1], dest, &arraySize[PA_END_NUM_CAUSAL_LINKS]);
+	dest = copyPlanArray(b.numVarValues[0], dest, &arraySize[PA_START_NUM_VALUES]);
+	dest = copyPlanArray(b.numVarValues[1], dest, &arraySize[PA_END_NUM_VALUES]);
+	dest = copyPlanArray(b.cvarValues, dest, &arraySize[PA_CONTROL_VARS]);
+	copyPlanArray(b.condEffects, dest, &arraySize[PA_COND_EFFECTS]);
+	b.clear();
 }
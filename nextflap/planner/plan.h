@@ -10,12 +10,11 @@
 
 #include "../sas/sasTask.h"
 #include "../utils/utils.h"
+#include "../utils/arena.h"
 #include "state.h"
 
-/*
 #define SEARCH_NRPG 0
 #define SEARCH_LAND 1
-*/
 
 class TFluentInterval {
 public:
@@ -46,58 +45,92 @@ public:
 	TNumericCausalLink(TTimePoint t, TVariable v) { timePoint = t; var = v; }
 };
 
+// View of an array stored in the data block of a plan
+template <typename T>
+class PlanArray {
+private:
+	T* items;
+	unsigned int numItems;
+
+public:
+	PlanArray(T* items, unsigned int numItems) { this->items = items; this->numItems = numItems; }
+	inline T* begin() { return items; }
+	inline T* end() { return items + numItems; }
+	inline unsigned int size() { return numItems; }
+	inline bool empty() { return numItems == 0; }
+	inline T& operator[](unsigned int index) { return items[index]; }
+};
+
+// Arrays of a plan. They are stored in this order in a single memory block
+enum PlanArrayType { PA_ORDERINGS = 0, PA_START_CAUSAL_LINKS = 1, PA_END_CAUSAL_LINKS = 2,
+	PA_START_NUM_CAUSAL_LINKS = 3, PA_END_NUM_CAUSAL_LINKS = 4, PA_START_NUM_VALUES = 5, PA_END_NUM_VALUES = 6,
+	PA_CONTROL_VARS = 7, PA_COND_EFFECTS = 8, PA_NUM_ARRAYS = 9 };
+
 class PlanPoint {
 private:
 	TTime time;									// Scheduled time for the begining/end of the action
 
 public:
-	TTime updatedTime;							// Final scheduled time, after applying updates in child plans
-	std::vector<TFluentInterval>* numVarValues;	// Numeric var. values. Vector is nullptr if the action does not modify numeric vbles.
-	std::vector<TCausalLink> causalLinks;		// New causal links. TStep is the support action. These CLs are sorted like the
-												// action prec. at that time point, followed by over all precs.
-	std::vector<TNumericCausalLink> numCausalLinks;
-
-	PlanPoint() { numVarValues = nullptr; }
-	void addCausalLink(TTimePoint timePoint, TVarValue varVal);
-	void addNumericCausalLink(TTimePoint timePoint, TVarValue var);
-	void addNumericValue(TVariable v, TFloatValue min, TFloatValue max);
-	inline void copyInitialTime() { updatedTime = time; }
-	inline void setInitialTime(TFloatValue t) { time = updatedTime = t; }
+	inline TTime getInitialTime() { return time; }	// Final time (after updates in child plans) is given by PlanComponents
+	inline void setInitialTime(TFloatValue t) { time = t; }
 };
 
 class Plan {
 private:
-	void addFluentIntervals(PlanPoint& pp, std::vector<SASNumericEffect>& eff);
+	static const unsigned int ARRAY_ITEM_SIZE[PA_NUM_ARRAYS];
+	char* data;								// Orderings, causal links, numeric values, control vars. and conditional effects
+	uint16_t arraySize[PA_NUM_ARRAYS];		// Number of items of each array in the data block
+
+	void addFluentIntervals(bool atStart, std::vector<SASNumericEffect>& eff);
 	void addConditionalEffect(unsigned int numEff);
+	inline unsigned int getArrayOffset(unsigned int type) {
+		unsigned int offset = 0;
+		for (unsigned int i = 0; i < type; i++)
+			offset += arraySize[i] * ARRAY_ITEM_SIZE[i];
+		return offset;
+	}
+	template <typename T>
+	inline PlanArray<T> getArray(unsigned int type) {
+		return PlanArray<T>((T*)(data + getArrayOffset(type)), arraySize[type]);
+	}
 
 public:
-	TPlanId id;
 	Plan* parentPlan;						// Pointer to its parent plan
-	std::vector<Plan*>* childPlans;			// Vector of child plans. This vector is nullptr if
+	ArenaVector<Plan*>* childPlans;			// Vector of child plans. This vector is nullptr if
 											// the plan has not been expanded yet
 	SASAction* action;						// New action added
-	bool fixedInit;							// True if the initial time is fixed (action cannot be delayed)
+	ArenaVector<TPlanUpdate>* planUpdates;	// Changes in previous steps of the plan
+	TPlanId id;
+	TStateId stateId;						// Frontier state (NO_STATE if it has not been calculated yet)
 	TInterval actionDuration;				// Action duration
-	std::vector<TInterval>* cvarValues;		// Control var. values. Vector is nullptr if the action has no control vars.
-	std::vector<TPlanUpdate>* planUpdates;	// Changes in previous steps of the plan
-	std::vector<TOrdering> orderings;		// New orderings (first time point [lower 16 bits] -> second time point [higher 16 bits])
 	PlanPoint startPoint;					// At-start plan data
 	PlanPoint endPoint;						// At-end plan data
-	bool repeatedState;						// True if the plan leads to a repeated state in the search
 	int g;									// Plan length
 	int h;									// Heuristic value
 	int hLand;
-	TState* fs;								// Frontier state
+	bool fixedInit;							// True if the initial time is fixed (action cannot be delayed)
+	bool repeatedState;						// True if the plan leads to a repeated state in the search
 	bool z3Checked;							// Plan checked by z3 solver?
 	bool invalid;							// Invalid plan (after z3 checking)
+	bool preferred;							// The new action is in the relaxed plan of the parent plan
+	bool evicted;							// Removed from the search tree to save memory (bounded-memory search)
+	bool pendingEvaluation;					// Frontier state calculated, but evaluation deferred (lazy distributed search)
+	uint8_t openLists;						// Number of open lists that store this plan
+	unsigned int timesVersion;				// Number of times the plan has been rescheduled by a validity check
+	unsigned int generation;				// Arena generation in which the plan was created
 	//int numUsefulActions;					// Number of useful actions included in the plan
-	std::vector<int>* holdCondEff;
 
 	Plan(SASAction* action, Plan* parentPlan, TPlanId idPlan, bool* holdCondEff);
 	~Plan();
+	static inline void* operator new(size_t size) { return Arena::allocate(size); }		// Plans are stored in the search arena
+	static inline void operator delete(void* p, size_t size) { Arena::deallocate(p, size); }	// If the constructor throws
+	static inline void operator delete(Plan* p, std::destroying_delete_t) {	// Nothing is freed if the arena was released
+		unsigned int generation = p->generation;
+		p->~Plan();
+		Arena::deallocate(p, sizeof(Plan), generation);
+	}
 	void setDuration(TFloatValue min, TFloatValue max);
 	void setTime(TTime init, TTime end, bool fixed);
-	int compare(Plan* p);
 	bool isRoot();
 	inline bool expanded() { return childPlans != nullptr; }
 	void addFluentIntervals();
@@ -105,7 +138,31 @@ public:
 	void addChildren(std::vector<Plan*>& suc);
 	void addPlanUpdate(TTimePoint tp, TFloatValue time);
 	int getCheckDistance();
-	//int getH(int queue);
+	size_t getMemorySize();
+	void removeChild(Plan* child);
+	inline int getH(int queue) { return queue == SEARCH_LAND ? hLand : h; }
+
+	// Plan construction. The data is kept in a per-thread buffer until compact() is called
+	void addOrdering(TOrdering o);
+	void addCausalLink(bool atStart, TTimePoint timePoint, TVarValue varVal);
+	void addNumericCausalLink(bool atStart, TTimePoint timePoint, TVariable var);
+	void addNumericValue(bool atStart, TVariable v, TFloatValue min, TFloatValue max);
+	void addControlVarValue(TInterval& value);
+	void compact();
+
+	// Plan data (only available once the plan has been compacted)
+	inline PlanArray<TOrdering> getOrderings() { return getArray<TOrdering>(PA_ORDERINGS); }
+	inline PlanArray<TCausalLink> getCausalLinks(bool atStart) {
+		return getArray<TCausalLink>(atStart ? PA_START_CAUSAL_LINKS : PA_END_CAUSAL_LINKS);
+	}
+	inline PlanArray<TNumericCausalLink> getNumericCausalLinks(bool atStart) {
+		return getArray<TNumericCausalLink>(atStart ? PA_START_NUM_CAUSAL_LINKS : PA_END_NUM_CAUSAL_LINKS);
+	}
+	inline PlanArray<TFluentInterval> getNumVarValues(bool atStart) {	// Empty if the action does not modify numeric vbles.
+		return getArray<TFluentInterval>(atStart ? PA_START_NUM_VALUES : PA_END_NUM_VALUES);
+	}
+	inline PlanArray<TInterval> getControlVarValues() { return getArray<TInterval>(PA_CONTROL_VARS); }
+	inline PlanArray<int> getConditionalEffects() { return getArray<int>(PA_COND_EFFECTS); }	// Conditional effects that hold
 };
 
 #endif
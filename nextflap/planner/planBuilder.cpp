@@ -33,14 +33,14 @@ PlanBuilderCausalLink::PlanBuilderCausalLink(TVarValue vv, TTimePoint p1, TTimeP
 /* CLASS: PlanBuilder                                   */
 /********************************************************/
 
-PlanBuilder::PlanBuilder(SASAction* a, TStep lastStep, std::vector< std::vector<unsigned int> >* matrix,
+PlanBuilder::PlanBuilder(SASAction* a, TStep lastStep, OrderMatrix* matrix, TemporalNetwork* network,
 	int numSupportState, PlanEffects* planEffects, SASTask* task)
 {
 	this->task = task;
 	action = a;
 	this->matrix = matrix;
+	this->network = network;
 	this->planEffects = planEffects; 
-	this->iteration = planEffects->iteration;
 	currentPrecondition = currentEffect = 0;
 	setPrecondition = MAX_UNSIGNED_INT;
 	lastTimePoint = stepToEndPoint(lastStep);
@@ -55,6 +55,8 @@ PlanBuilder::PlanBuilder(SASAction* a, TStep lastStep, std::vector< std::vector<
 
 PlanBuilder::~PlanBuilder()
 {
+	while (!numOrderingsAdded.empty())	// The order matrix is shared, so the orderings added are removed
+		removeLastOrdering();
 	if (condEffHold != nullptr)
 		delete[] condEffHold;
 }
@@ -98,126 +100,11 @@ bool PlanBuilder::addNumLink(TVariable v, TTimePoint p1, TTimePoint p2)
 	return false;
 }
 
-// Checks if TILs (timed initial literals) are properly scheduled
+// Checks if TILs (timed initial literals) are properly scheduled. The new time points are checked
+// when the plan is generated, as the bounds of the new step are not known yet
 bool PlanBuilder::invalidTILorder(TTimePoint p1, TTimePoint p2) {
-	TStep s1 = timePointToStep(p1), s2 = timePointToStep(p2);
-	if (s1 < planEffects->planComponents->size() && s2 < planEffects->planComponents->size()) {
-		Plan* plan1 = planEffects->planComponents->get(s1);
-		if (plan1->fixedInit) {
-			Plan* plan2 = planEffects->planComponents->get(s2);
-			if (plan2->fixedInit) {
-				TFloatValue time1 = (p1 & 1) == 0 ? plan1->startPoint.updatedTime : plan1->endPoint.updatedTime;
-				TFloatValue time2 = (p2 & 1) == 0 ? plan2->startPoint.updatedTime : plan2->endPoint.updatedTime;
-				return time2 < time1;
-			}
-		}
-	}
-	return false;
-}
-
-// Computes a linear order of the plan timepoints
-void PlanBuilder::topologicalOrder(std::vector<TTimePoint>* linearOrder)
-{
-	unsigned int size = lastTimePoint + 1;
-	linearOrder->resize(size, 0);
-	std::vector<bool> visited(size, false);
-	topologicalOrder(1, linearOrder, lastTimePoint, &visited);
-}
-
-// Computes a linear order of the plan timepoints
-unsigned int PlanBuilder::topologicalOrder(TTimePoint orig, std::vector<TTimePoint>* linearOrder, unsigned int pos, std::vector<bool>* visited)
-{
-	(*visited)[orig] = true;
-	for (unsigned int i = 2; i <= linearOrder->size(); i++) {
-		if (existOrder(orig, i)) {
-			if (!((*visited)[i])) {
-				// cout << orig << " -> " << i << endl;
-				pos = topologicalOrder(i, linearOrder, pos, visited);
-			}
-		}
-	}
-	(*linearOrder)[pos--] = orig;
-	return pos;
-}
-
-// Check if there are steps in the plan that need to be delayed
-bool PlanBuilder::delaySteps(Plan* p, std::vector<TTimePoint>& pointToDelay, std::vector<TFloatValue>& newTime,
-	std::vector<TTimePoint>& linearOrder)
-{
-	// Following the linear order, try to delay the points that do not meet the constraints. If one action cannot be
-	// delayed of it delays a previous point (according to the linear order) we call Z3 to verify if there is a valid
-	// schedule
-	std::unordered_map<TTimePoint, int> indexInLinearOrder;
-	for (int i = 0; i < linearOrder.size(); i++) indexInLinearOrder[linearOrder[i]] = i;
-	PriorityQueue pq((unsigned int)linearOrder.size());
-	for (int i = 0; i < pointToDelay.size(); i++) {
-		TTimePoint tp = pointToDelay[i];
-		if ((tp & 1) == 1) { // End of the action -> delay its begining
-			Plan* step = planEffects->planComponents->get(timePointToStep(tp));
-			TFloatValue startTime = step->startPoint.updatedTime + newTime[i] - step->endPoint.updatedTime;
-			pq.add(new PBTimepointToDelay(tp - 1, startTime, indexInLinearOrder[tp - 1]));
-		}
-		else {
-			pq.add(new PBTimepointToDelay(pointToDelay[i], newTime[i], indexInLinearOrder[pointToDelay[i]]));
-		}
-	}
-	std::vector<TFloatValue> resNewTimes(linearOrder.size(), FLOAT_INFINITY);
-	bool ok = true;
-	TStep currentStep = timePointToStep(lastTimePoint);
-	while (pq.size() > 0 && ok) {
-		PBTimepointToDelay* pqItem = (PBTimepointToDelay*)pq.poll();
-		TTimePoint tp = pqItem->tp;
-		TFloatValue pqNewTime = pqItem->newTime;
-		int pqOrder = pqItem->linearOrderIndex;
-		//cout << "Timepoint: " << tp << ", Order: " << pqOrder << ", Time: " << pqNewTime << endl;
-		delete pqItem;
-		if (resNewTimes[tp] != FLOAT_INFINITY && resNewTimes[tp] < pqNewTime) { // New delay -> avoid inf. loops
-			ok = false; // Let Z3 to solve
-			break;
-		}
-		if (resNewTimes[tp] == FLOAT_INFINITY) { // Update the time if it is needed
-			TStep indexStepToDelay = timePointToStep(tp);
-			Plan* stepToDelay = indexStepToDelay < currentStep ? planEffects->planComponents->get(indexStepToDelay) : p;
-			bool update = (tp & 1) == 0 ? stepToDelay->startPoint.updatedTime < pqNewTime : 
-				stepToDelay->endPoint.updatedTime < pqNewTime;
-			if (update) { // Update needed
-				if (stepToDelay->fixedInit) {
-					ok = false;	// Action cannot be delayed
-					break;
-				}
-				if ((tp & 1) == 0) { // Update also the end of the action
-					TFloatValue inc = pqNewTime - stepToDelay->startPoint.updatedTime;
-					resNewTimes[tp + 1] = stepToDelay->endPoint.updatedTime + inc;
-					// Check the following steps that could also need to be delayed
-					for (int nextIndex = indexInLinearOrder[tp + 1] + 1; nextIndex < linearOrder.size(); nextIndex++) {
-						TTimePoint nextTimepoint = linearOrder[nextIndex];
-						if (existOrder(tp + 1, nextTimepoint)) {
-							//cout << "* Timepoint " << nextTimepoint << " added by " << (tp + 1) << endl;
-							pq.add(new PBTimepointToDelay(nextTimepoint, resNewTimes[tp + 1] + EPSILON, nextIndex));
-						}
-					}
-				}
-				resNewTimes[tp] = pqNewTime;
-				// Check the following steps that could also need to be delayed
-				for (int nextIndex = pqOrder + 1; nextIndex < linearOrder.size(); nextIndex++) {
-					TTimePoint nextTimepoint = linearOrder[nextIndex];
-					if (existOrder(tp, nextTimepoint)) {
-						//cout << "* Timepoint " << nextTimepoint << " added by " << tp << endl;
-						pq.add(new PBTimepointToDelay(nextTimepoint, resNewTimes[tp] + EPSILON, nextIndex));
-					}
-				}
-			}	
-		}
-	}
-	while (pq.size() > 0) delete (PBTimepointToDelay*)pq.poll();
-	if (ok) {
-		for (int tp = 0; tp < resNewTimes.size(); tp++) {
-			if (resNewTimes[tp] != FLOAT_INFINITY) {
-				p->addPlanUpdate(tp, resNewTimes[tp]);
-			}
-		}
-	}
-	return ok;
+	if (p1 >= lastTimePoint - 1 || p2 >= lastTimePoint - 1) return false;
+	return network->invalidOrdering(p1, p2);
 }
 
 // Adds an ordering to the plan
@@ -226,31 +113,7 @@ bool PlanBuilder::addOrdering(TTimePoint p1, TTimePoint p2) {
 	if (existOrder(p1, p2)) numOrderingsAdded.push_back(0);	// Ordering already exists
 	else if (invalidTILorder(p1, p2)) return false;
 	else {
-		unsigned int newOrderings = 0;
-		TTimePoint prevP1, nextP2;
-		prevPoints.clear();
-		nextPoints.clear();
-		prevPoints.push_back(p1);
-		nextPoints.push_back(p2);
-		for (TTimePoint t = 1; t <= lastTimePoint; t++) {
-			if (existOrder(t, p1)) prevPoints.push_back(t);
-			if (existOrder(p2, t)) nextPoints.push_back(t);
-		}
-		for (unsigned int i = 0; i < prevPoints.size(); i++) {
-			prevP1 = prevPoints[i];
-			// cout << "* PrevPoint = " << prevP1 << " (from " << lastTimePoint << ")" << endl;
-			for (unsigned int j = 0; j < nextPoints.size(); j++) {
-				nextP2 = nextPoints[j];
-				// cout << "* NextPoint = " << nextP2 << endl;
-				if (prevP1 != nextP2 && !existOrder(prevP1, nextP2)) {
-					newOrderings++;
-					setOrder(prevP1, nextP2);
-					orderings.push_back(getOrdering(prevP1, nextP2));
-					//cout << "+ Ord: " << prevP1 << " ---> " << nextP2 << endl;
-				} // else cout << "   * Ord " << prevP1 << " -> " << nextP2 << " already exists" << endl;
-			}
-		}
-		numOrderingsAdded.push_back(newOrderings);
+		numOrderingsAdded.push_back(matrix->addOrderings(p1, p2, lastTimePoint, prevPoints, orderings));
 	}
 	return true;
 }
@@ -267,9 +130,11 @@ Plan* PlanBuilder::generatePlan(Plan* basePlan, TPlanId idPlan) {
 	}
 	ic.copyControlVars(p);
 	ic.copyDuration(p);
+	if (!network->consistentStep(lastTimePoint - 1, p->actionDuration.minValue, orderings, matrix)) {
+		delete p;		// The new step cannot be scheduled (deadlines of TILs)
+		return nullptr;
+	}
 	setActionStartTime(p);
-	//std::vector<TTimePoint> linearOrder;
-	//topologicalOrder(&linearOrder);
 	for (PlanBuilderCausalLink& pbcl : causalLinks) {
 		if (pbcl.getValue() == MAX_UINT16)
 			addNumericCausalLinkToPlan(p, pbcl.firstPoint(), pbcl.secondPoint(), pbcl.getVar());
@@ -278,23 +143,22 @@ Plan* PlanBuilder::generatePlan(Plan* basePlan, TPlanId idPlan) {
 	}
 	for (TOrdering o : orderings) {
 		//cout << "Adding ordering: " << firstPoint(o) << "->" << secondPoint(o) << endl;
-		p->orderings.push_back(o);
+		p->addOrdering(o);
 	}
+	p->compact();
 	return p;
 }
 
 // Adds a new causal link to the plan
 void PlanBuilder::addCausalLinkToPlan(Plan* p, TTimePoint p1, TTimePoint p2, TVarValue varValue)
 {
-	PlanPoint& pPoint = ((p2 & 1) == 0) ? p->startPoint : p->endPoint;
-	pPoint.addCausalLink(p1, varValue);
+	p->addCausalLink((p2 & 1) == 0, p1, varValue);
 }
 
 // Adds a new numeric causal link to the plan
 void PlanBuilder::addNumericCausalLinkToPlan(Plan* p, TTimePoint p1, TTimePoint p2, TVariable var)
 {
-	PlanPoint& pPoint = ((p2 & 1) == 0) ? p->startPoint : p->endPoint;
-	pPoint.addNumericCausalLink(p1, var);
+	p->addNumericCausalLink((p2 & 1) == 0, p1, var);
 }
 
 // Sets the start time of the new action (as soon as possible)
@@ -305,91 +169,21 @@ void PlanBuilder::setActionStartTime(Plan* p)
 	for (TOrdering o : orderings) {
 		TTimePoint endPoint = secondPoint(o);
 		if (endPoint == startNewStep) { // []------>[   New step   ]
-			TTimePoint startPoint = firstPoint(o);
-			Plan* prevStep = planEffects->planComponents->get(timePointToStep(startPoint));
-			if ((startPoint & 1) == 0) { // [---prevStep---]----->[   NewStep   ]
-				TFloatValue time = prevStep->startPoint.updatedTime + EPSILON;
-				if (p->startPoint.updatedTime < time) {
-					p->startPoint.setInitialTime(time);
-				}
-			}
-			else { // [   prevStep   ]----->[   NewStep   ]
-				TFloatValue time = prevStep->endPoint.updatedTime + EPSILON;
-				if (p->startPoint.updatedTime < time) {
-					p->startPoint.setInitialTime(time);
-				}
+			TFloatValue time = planEffects->planComponents->getTime(firstPoint(o)) + EPSILON;
+			if (p->startPoint.getInitialTime() < time) {
+				p->startPoint.setInitialTime(time);
 			}
 		}
 		else if (endPoint == lastTimePoint) { // []-------[---NewStep--->]
-			TTimePoint startPoint = firstPoint(o);
-			Plan* prevStep = planEffects->planComponents->get(timePointToStep(startPoint));
-			if ((startPoint & 1) == 0) { // [---prevStep---]-----[---NewStep--->]
-				TFloatValue time = prevStep->startPoint.updatedTime + EPSILON;
-				if (p->startPoint.updatedTime + p->actionDuration.minValue < time) {
-					p->startPoint.setInitialTime(time - p->actionDuration.minValue);
-				}
-			}
-			else { // [   prevStep   ]-----[---NewStep--->]
-				TFloatValue time = prevStep->endPoint.updatedTime + EPSILON;
-				if (p->startPoint.updatedTime + p->actionDuration.minValue < time) {
-					p->startPoint.setInitialTime(time - p->actionDuration.minValue);
-				}
+			TFloatValue time = planEffects->planComponents->getTime(firstPoint(o)) + EPSILON;
+			if (p->startPoint.getInitialTime() + p->actionDuration.minValue < time) {
+				p->startPoint.setInitialTime(time - p->actionDuration.minValue);
 			}
 		}
 	}
-	p->endPoint.setInitialTime(p->startPoint.updatedTime);
 	if (p->actionDuration.maxValue < FLOAT_INFINITY)
-		p->endPoint.setInitialTime(p->endPoint.updatedTime + 
+		p->endPoint.setInitialTime(p->startPoint.getInitialTime() + 
 			(p->actionDuration.minValue + p->actionDuration.maxValue) / 2.0f);
 	else
-		p->endPoint.setInitialTime(p->endPoint.updatedTime + p->actionDuration.minValue);
-}
-
-// Checks if the steps ordered after the new one must be delayed
-bool PlanBuilder::checkFollowingSteps(Plan* p, std::vector<TTimePoint>& linearOrder)
-{
-	std::vector<TTimePoint> pointToDelay;
-	std::vector<TFloatValue> newTime;
-	TTimePoint startNewStep = lastTimePoint - 1;
-	for (TOrdering o : orderings) {
-		TTimePoint startPoint = firstPoint(o);
-		if (startPoint == startNewStep) {       // [---NewStep---]----->[]
-			TTimePoint endPoint = secondPoint(o);
-			Plan* nextStep = planEffects->planComponents->get(timePointToStep(endPoint));
-			if ((endPoint & 1) == 0) { // [---NewStep---]----->[         ]
-				TFloatValue nextTime = nextStep->startPoint.updatedTime;
-				if (p->startPoint.updatedTime + EPSILON > nextTime) { // The begining of the next step must be delayed
-					pointToDelay.push_back(endPoint);
-					newTime.push_back(p->startPoint.updatedTime + EPSILON);
-				}
-			}
-			else { // [---NewStep---]------[-------->]
-				TFloatValue nextTime = nextStep->endPoint.updatedTime;
-				if (p->startPoint.updatedTime + EPSILON > nextTime) { // The end of the next step must be delayed
-					pointToDelay.push_back(endPoint);
-					newTime.push_back(p->startPoint.updatedTime + EPSILON);
-				}
-			}
-		}
-		else if (startPoint == lastTimePoint) { // [   NewStep   ]----->[]
-			TTimePoint endPoint = secondPoint(o);
-			Plan* nextStep = planEffects->planComponents->get(timePointToStep(endPoint));
-			if ((endPoint & 1) == 0) { // [   NewStep   ]----->[         ]
-				TFloatValue nextTime = nextStep->startPoint.updatedTime;
-				if (p->startPoint.updatedTime + p->actionDuration.minValue + EPSILON > nextTime) { // The begining of the next step must be delayed
-					pointToDelay.push_back(endPoint);
-					newTime.push_back(p->startPoint.updatedTime + p->actionDuration.minValue + EPSILON);
-				}
-			}
-			else { // [   NewStep   ]------[-------->]
-				TFloatValue nextTime = nextStep->endPoint.updatedTime;
-				if (p->startPoint.updatedTime + p->actionDuration.minValue + EPSILON > nextTime) { // The end of the next step must be delayed
-					pointToDelay.push_back(endPoint);
-					newTime.push_back(p->startPoint.updatedTime + p->actionDuration.minValue + EPSILON);
-				}
-			}
-		}
-	}
-	if (pointToDelay.empty()) return true;
-	else return delaySteps(p, pointToDelay, newTime, linearOrder);
+		p->endPoint.setInitialTime(p->startPoint.getInitialTime() + p->actionDuration.minValue);
 }
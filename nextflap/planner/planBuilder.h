@@ -2,11 +2,12 @@
 #define PLAN_BUILDER_H
 
 #include "../utils/utils.h"
-#include "../utils/priorityQueue.h"
 #include "../sas/sasTask.h"
 #include "planEffects.h"
 #include "plan.h"
 #include "intervalCalculations.h"
+#include "orderMatrix.h"
+#include "temporalNetwork.h"
 
 /********************************************************/
 /* Oscar Sapena Vercher - DSIC - UPV                    */
@@ -37,52 +38,21 @@ public:
 	PlanBuilderCausalLink(TVarValue vv, TTimePoint p1, TTimePoint p2);
 };
 
-// Timepoint that needs to be delayed
-class PBTimepointToDelay : public PriorityQueueItem {
-public:
-	TTimePoint tp;
-	TFloatValue newTime;
-	int linearOrderIndex;
-
-	PBTimepointToDelay(TTimePoint p, TFloatValue t, int i) {
-		tp = p;
-		newTime = t;
-		linearOrderIndex = i;
-	}
-	inline int compare(PriorityQueueItem* other) {
-		int res = linearOrderIndex - ((PBTimepointToDelay*)other)->linearOrderIndex;
-		if (res == 0) {
-			if (newTime < ((PBTimepointToDelay*)other)->newTime) return 1;
-			else return -1;
-		}
-		else return res;
-	}
-	virtual ~PBTimepointToDelay() { }
-};
-
 // Plan builder
 class PlanBuilder {
 private:
 	SASTask* task;
-	unsigned int iteration;
-	std::vector< std::vector<unsigned int> >* matrix;
+	OrderMatrix* matrix;
+	TemporalNetwork* network;
 	std::vector<TTimePoint> prevPoints;	// For internal calculations
-	std::vector<TTimePoint> nextPoints;	// For internal calculations
 	PlanEffects* planEffects;
 
-	inline bool existOrder(TTimePoint t1, TTimePoint t2) { return (*matrix)[t1][t2] == iteration; }
-	inline void setOrder(TTimePoint t1, TTimePoint t2) { (*matrix)[t1][t2] = iteration; }
-	inline void clearOrder(TTimePoint t1, TTimePoint t2) { (*matrix)[t1][t2] = 0; }
+	inline bool existOrder(TTimePoint t1, TTimePoint t2) { return matrix->existOrder(t1, t2); }
+	inline void clearOrder(TTimePoint t1, TTimePoint t2) { matrix->clearOrder(t1, t2); }
 	void addCausalLinkToPlan(Plan* p, TTimePoint p1, TTimePoint p2, TVarValue varValue);
 	void addNumericCausalLinkToPlan(Plan* p, TTimePoint p1, TTimePoint p2, TVariable var);
 	void setActionStartTime(Plan* p);
-	bool checkFollowingSteps(Plan* p, std::vector<TTimePoint>& linearOrder);
 	bool invalidTILorder(TTimePoint p1, TTimePoint p2);
-	void topologicalOrder(std::vector<TTimePoint>* linearOrder);
-	unsigned int topologicalOrder(TTimePoint orig, std::vector<TTimePoint>* linearOrder, unsigned int pos,
-		std::vector<bool>* visited);
-	bool delaySteps(Plan* p, std::vector<TTimePoint>& pointToDelay, std::vector<TFloatValue>& newTime,
-		std::vector<TTimePoint>& linearOrder);
 
 public:
 	SASAction* action;					// New action added
@@ -97,7 +67,7 @@ public:
 	int numSupportState;
 	bool* condEffHold;
 
-	PlanBuilder(SASAction* a, TStep lastStep, std::vector< std::vector<unsigned int> >* matrix,
+	PlanBuilder(SASAction* a, TStep lastStep, OrderMatrix* matrix, TemporalNetwork* network,
 		int numSupportState, PlanEffects* planEffects, SASTask* task);
 	~PlanBuilder();
 	bool addLink(SASCondition* c, TTimePoint p1, TTimePoint p2);
@@ -8,25 +8,65 @@
 /* step is called plan component.)                      */
 /********************************************************/
 
+PlanComponents::PlanComponents()
+{
+	numSteps = 0;
+}
+
+// The plans are not modified, so they can be shared by several search threads. The components of the
+// previous plan calculated are kept, so only the steps that are not shared with it are added. A step is
+// not shared either if its plan has been rescheduled (by a validity check) since it was applied
 void PlanComponents::calculate(Plan* base)
 {
-	if (base == nullptr) {
-		basePlanComponents.clear();
-		numSteps = 0;
+	newComponents.clear();
+	for (; base != nullptr; base = base->parentPlan)
+		newComponents.push_back(base);
+	TStep shared = 0, size = (TStep)newComponents.size();
+	while (shared < numSteps && shared < size) {
+		Plan* p = newComponents[size - shared - 1];
+		if (basePlanComponents[shared] != p || ids[shared] != p->id || versions[shared] != p->timesVersion)
+			break;
+		shared++;
+	}
+	undo(shared);
+	for (int i = (int)(size - shared) - 1; i >= 0; i--)
+		apply(newComponents[i]);
+}
+
+// Removes the components from the given step
+void PlanComponents::undo(TStep step)
+{
+	if (step >= numSteps) return;
+	unsigned int size = step == 0 ? 0 : updatesEnd[step - 1];
+	while (overwritten.size() > size) {
+		TPlanUpdate& u = overwritten.back();
+		times[u.timePoint] = u.newTime;
+		overwritten.pop_back();
 	}
-	else {
-		calculate(base->parentPlan);
-		base->startPoint.copyInitialTime();
-		base->endPoint.copyInitialTime();
-		basePlanComponents.push_back(base);
-		numSteps++;
-		if (base->planUpdates != nullptr) {
-			for (TPlanUpdate& u : *(base->planUpdates)) {
-				TStep stepIndex = timePointToStep(u.timePoint);
-				Plan* step = basePlanComponents[stepIndex];
-				if ((u.timePoint & 1) == 0) step->startPoint.updatedTime = u.newTime;
-				else step->endPoint.updatedTime = u.newTime;
-			}
+	basePlanComponents.resize(step);
+	ids.resize(step);
+	versions.resize(step);
+	versionSums.resize(step);
+	updatesEnd.resize(step);
+	times.resize(stepToStartPoint(step));
+	numSteps = step;
+}
+
+// Adds a new component
+void PlanComponents::apply(Plan* p)
+{
+	basePlanComponents.push_back(p);
+	ids.push_back(p->id);
+	versions.push_back(p->timesVersion);
+	versionSums.push_back(getTimesVersion(numSteps) + p->timesVersion);
+	times.push_back(p->startPoint.getInitialTime());
+	times.push_back(p->endPoint.getInitialTime());
+	numSteps++;
+	if (p->planUpdates != nullptr) {
+		for (TPlanUpdate& u : *(p->planUpdates)) {
+			overwritten.emplace_back(u.timePoint, times[u.timePoint]);
+			times[u.timePoint] = u.newTime;
 		}
 	}
+	updatesEnd.push_back((unsigned int)overwritten.size());
 }
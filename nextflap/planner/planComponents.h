@@ -15,12 +15,26 @@ class PlanComponents {
 private:
 	TStep numSteps;
 	std::vector<Plan*> basePlanComponents;	// The base plan is made up by incremental components, which are stored in this vector
+	std::vector<TPlanId> ids;				// Ids of the components (to detect reused memory)
+	std::vector<unsigned int> versions;		// Times version of each component when it was applied
+	std::vector<unsigned int> versionSums;	// Sum of the versions of the components up to each step
+	std::vector<TTime> times;				// Scheduled time of each time point, after applying the updates in the child plans
+	std::vector<TPlanUpdate> overwritten;	// Previous times of the points updated by each component
+	std::vector<unsigned int> updatesEnd;	// Size of the overwritten vector after applying each component
+	std::vector<Plan*> newComponents;		// For internal calculations
+
+	void undo(TStep step);
+	void apply(Plan* p);
 
 public:
+	PlanComponents();
 	void calculate(Plan* base);
 	inline TStep size() { return numSteps; }
 	inline Plan* get(TStep index) { return basePlanComponents[index]; }
-	void removeLast() { basePlanComponents.pop_back(); numSteps--; }
+	inline TTime getTime(TTimePoint tp) { return times[tp]; }
+	void removeLast() { undo(numSteps - 1); }
+	// Sum of the times versions of the first steps. It only changes if one of these steps is rescheduled
+	inline unsigned int getTimesVersion(TStep steps) { return steps == 0 ? 0 : versionSums[steps - 1]; }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -148,7 +148,7 @@ TFloatValue PlanEffects::getMinControlVarValue(TTimePoint timepoint, TVariable v
 {
 	TStep step = timePointToStep(timepoint);
 	Plan* plan = planComponents->get(step);
-	return plan->cvarValues->at(var).minValue;
+	return plan->getControlVarValues()[var].minValue;
 }
 
 TFloatValue PlanEffects::getNumVarMaxValue(TVariable var, int stateIndex)
@@ -174,5 +174,5 @@ TFloatValue PlanEffects::getMaxControlVarValue(TTimePoint timepoint, TVariable v
 {
 	TStep step = timePointToStep(timepoint);
 	Plan* plan = planComponents->get(step);
-	return plan->cvarValues->at(var).maxValue;
+	return plan->getControlVarValues()[var].maxValue;
 }
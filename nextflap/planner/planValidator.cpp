@@ -0,0 +1,270 @@
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Fast plan validity checking, used before calling Z3. */
+/********************************************************/
+
+#include <cmath>
+#include <climits>
+#include "planValidator.h"
+using namespace std;
+
+/********************************************************/
+/* CLASS: PlanValidator                                 */
+/********************************************************/
+
+// Checks the plan. If it is valid, the times of its steps are updated
+ValidationResult PlanValidator::checkPlan(Plan* p, PlanComponents* planComponents)
+{
+	this->planComponents = planComponents;
+	TStep numSteps = planComponents->size();
+	values.clear();
+	valuesStart.clear();
+	duration.assign(numSteps, NAN);
+	minDuration.resize(numSteps);
+	maxDuration.resize(numSteps);
+	for (TStep s = 0; s < numSteps; s++) {
+		Plan* pc = planComponents->get(s);
+		if (!pc->action->controlVars.empty())
+			return VR_UNKNOWN;					// The values of the control variables must be found by Z3
+		valuesStart.push_back((unsigned int)values.size());
+		values.insert(values.end(), pc->getNumVarValues(true).size(), NAN);
+		valuesStart.push_back((unsigned int)values.size());
+		values.insert(values.end(), pc->getNumVarValues(false).size(), NAN);
+	}
+	ValidationResult res = VR_VALID;
+	for (TStep s = 0; s < numSteps; s++) {		// The steps only depend on the previous ones
+		ValidationResult stepRes = calculateValues(planComponents->get(s), s);
+		if (stepRes == VR_INVALID) return VR_INVALID;
+		if (stepRes == VR_UNKNOWN) res = VR_UNKNOWN;
+	}
+	if (res == VR_UNKNOWN || !schedule())
+		return VR_UNKNOWN;
+	updatePlan(p);
+	return VR_VALID;
+}
+
+// Returns the value of a fluent modified in the given time point (nullptr if the time point does not modify it)
+double* PlanValidator::getValue(TVariable var, TTimePoint tp)
+{
+	Plan* p = planComponents->get(timePointToStep(tp));
+	unsigned int index = valuesStart[tp];
+	for (TFluentInterval& f : p->getNumVarValues((tp & 1) == 0)) {
+		if (f.numVar == var) return &values[index];
+		index++;
+	}
+	return nullptr;
+}
+
+// Returns the value of a fluent in a time point, given by its numeric causal link (as in Z3Checker::getProductorVar)
+double PlanValidator::getProductorValue(TVariable var, TTimePoint tp)
+{
+	Plan* p = planComponents->get(timePointToStep(tp));
+	TTimePoint productor = MAX_UINT16;
+	if ((tp & 1) == 1) { // End point
+		for (TNumericCausalLink& cl : p->getNumericCausalLinks(false))
+			if (cl.var == var) { productor = cl.timePoint; break; }
+	}
+	if (productor == MAX_UINT16) {
+		for (TNumericCausalLink& cl : p->getNumericCausalLinks(true))
+			if (cl.var == var) { productor = cl.timePoint; break; }
+	}
+	if (productor == MAX_UINT16) {
+		for (TNumericCausalLink& cl : p->getNumericCausalLinks(false))
+			if (cl.var == var) { productor = cl.timePoint; break; }
+	}
+	if (productor == MAX_UINT16) return NAN;
+	double* value = getValue(var, productor);
+	return value != nullptr ? *value : NAN;
+}
+
+// Evaluates a numeric expression in a time point. Returns NaN if the value cannot be computed
+double PlanValidator::evaluate(SASNumericExpression& e, TTimePoint tp)
+{
+	switch (e.type) {
+	case 'N':	// GE_NUMBER (with the same precision as in Z3)
+		return intVal(e.value) / 1000.0;
+	case 'V':	// GE_VAR
+		return getProductorValue(e.var, tp);
+	case '+':
+		return evaluate(e.terms[0], tp) + evaluate(e.terms[1], tp);
+	case '-':
+		return evaluate(e.terms[0], tp) - evaluate(e.terms[1], tp);
+	case '*':
+		return evaluate(e.terms[0], tp) * evaluate(e.terms[1], tp);
+	case '/': {
+		double divisor = evaluate(e.terms[1], tp);
+		return divisor == 0 ? NAN : evaluate(e.terms[0], tp) / divisor;
+	}
+	case 'D':	// GE_DURATION
+		return duration[timePointToStep(tp)];
+	}
+	return NAN;	// Control variables
+}
+
+// Calculates the duration bounds of a step. Returns false if they cannot be computed
+bool PlanValidator::calculateDuration(Plan* p, TStep s)
+{
+	double low = -INFINITY, high = INFINITY;
+	for (SASDurationCondition& d : p->action->duration.conditions) {
+		double value = evaluate(d.exp, d.time != 'E' ? stepToStartPoint(s) : stepToEndPoint(s));
+		if (std::isnan(value)) return false;
+		switch (d.comp) {
+		case '=':	low = max(low, value);	high = min(high, value);	break;
+		case 'L':	high = min(high, value);	break;
+		case 'G':	low = max(low, value);	break;
+		default:	return false;			// Strict comparisons are left to Z3
+		}
+	}
+	if (low == high) duration[s] = low;
+	// Z3 requires |end - start - 1000 * duration| < 0.5, in thousandths
+	minDuration[s] = low == -INFINITY ? INT_MIN : (int)ceil(1000 * low - 0.5 + 1e-6);
+	maxDuration[s] = high == INFINITY ? INT_MAX : (int)floor(1000 * high + 0.5 - 1e-6);
+	return minDuration[s] <= maxDuration[s];
+}
+
+// Applies the numeric effects in a time point. Returns false if a value is not computed
+bool PlanValidator::applyEffects(std::vector<SASNumericEffect>& effects, TTimePoint tp)
+{
+	bool ok = true;
+	for (SASNumericEffect& e : effects) {
+		double* v = getValue(e.var, tp);
+		if (v == nullptr) {
+			ok = false;
+			continue;
+		}
+		double value = evaluate(e.exp, tp);
+		switch (e.op) {
+		case '+':	value = getProductorValue(e.var, tp) + value;	break;
+		case '-':	value = getProductorValue(e.var, tp) - value;	break;
+		case '*':	value = getProductorValue(e.var, tp) * value;	break;
+		case '/':	value = value == 0 ? NAN : getProductorValue(e.var, tp) / value;	break;
+		}
+		if (!std::isnan(*v) && *v != value) ok = false;		// Different values in the same time point
+		*v = value;
+		if (std::isnan(value)) ok = false;
+	}
+	return ok;
+}
+
+// Checks a numeric condition in a time point
+ValidationResult PlanValidator::checkCondition(SASNumericCondition& c, TTimePoint tp)
+{
+	if (c.comp == '-') return VR_VALID;		// Dummy comparator (no constraint in Z3)
+	double v1 = evaluate(c.terms[0], tp), v2 = evaluate(c.terms[1], tp);
+	if (std::isnan(v1) || std::isnan(v2)) return VR_UNKNOWN;
+	if (v1 != v2 && abs(v1 - v2) <= 1e-6 * max(1.0, max(abs(v1), abs(v2))))
+		return VR_UNKNOWN;					// Too close to decide it with floating point numbers
+	bool holds;
+	switch (c.comp) {
+	case '=':	holds = v1 == v2;	break;
+	case 'L':	holds = v1 <= v2;	break;
+	case 'G':	holds = v1 >= v2;	break;
+	case '<':	if (v1 == v2) return VR_UNKNOWN;	holds = v1 < v2;	break;
+	case '>':	if (v1 == v2) return VR_UNKNOWN;	holds = v1 > v2;	break;
+	case 'N':	if (v1 == v2) return VR_UNKNOWN;	holds = true;		break;
+	default:	return VR_UNKNOWN;
+	}
+	return holds ? VR_VALID : VR_INVALID;
+}
+
+// Checks a list of numeric conditions in a time point
+ValidationResult PlanValidator::checkConditions(std::vector<SASNumericCondition>& conditions, TTimePoint tp)
+{
+	ValidationResult res = VR_VALID;
+	for (SASNumericCondition& c : conditions) {
+		ValidationResult condRes = checkCondition(c, tp);
+		if (condRes == VR_INVALID) return VR_INVALID;
+		if (condRes == VR_UNKNOWN) res = VR_UNKNOWN;
+	}
+	return res;
+}
+
+// Calculates the duration and the fluent values of a step, and checks its numeric conditions (the same
+// constraints defined in Z3Checker::defineConstraints)
+ValidationResult PlanValidator::calculateValues(Plan* p, TStep s)
+{
+	SASAction* a = p->action;
+	TTimePoint start = stepToStartPoint(s), end = stepToEndPoint(s);
+	bool ok = calculateDuration(p, s);
+	for (unsigned int numEff : p->getConditionalEffects())
+		ok &= applyEffects(a->conditionalEff[numEff].startNumEff, start);
+	ok &= applyEffects(a->startNumEff, start);
+	for (unsigned int numEff : p->getConditionalEffects())
+		ok &= applyEffects(a->conditionalEff[numEff].endNumEff, end);
+	ok &= applyEffects(a->endNumEff, end);
+	ValidationResult res = ok ? VR_VALID : VR_UNKNOWN;
+	ValidationResult condRes[] = { checkConditions(a->startNumCond, start), checkConditions(a->overNumCond, start),
+		checkConditions(a->overNumCond, end), checkConditions(a->endNumCond, end) };
+	for (ValidationResult r : condRes) {
+		if (r == VR_INVALID) return VR_INVALID;
+		if (r == VR_UNKNOWN) res = VR_UNKNOWN;
+	}
+	for (unsigned int numEff : p->getConditionalEffects()) {
+		SASConditionalEffect& e = a->conditionalEff[numEff];
+		ValidationResult startRes = checkConditions(e.startNumCond, start), endRes = checkConditions(e.endNumCond, end);
+		if (startRes == VR_INVALID || endRes == VR_INVALID) return VR_INVALID;
+		if (startRes == VR_UNKNOWN || endRes == VR_UNKNOWN) res = VR_UNKNOWN;
+	}
+	return res;
+}
+
+// Schedules the time points as soon as possible (and not before time 0), fulfilling the orderings and the
+// durations. Returns false if no schedule is found, so Z3 has to be used
+bool PlanValidator::schedule()
+{
+	TStep numSteps = planComponents->size();
+	unsigned int numPoints = stepToStartPoint(numSteps);
+	times.assign(numPoints, 0);
+	times[0] = -1;								// Initial step
+	bool changed = true;
+	for (unsigned int iteration = 0; changed && iteration <= numPoints; iteration++) {
+		changed = false;
+		for (TStep s = 0; s < numSteps; s++) {
+			TTimePoint start = stepToStartPoint(s), end = stepToEndPoint(s);
+			if (minDuration[s] != INT_MIN && times[end] < times[start] + minDuration[s]) {
+				times[end] = times[start] + minDuration[s];
+				changed = true;
+			}
+			if (maxDuration[s] != INT_MAX && times[start] < times[end] - maxDuration[s]) {
+				times[start] = times[end] - maxDuration[s];
+				changed = true;
+			}
+			for (TOrdering o : planComponents->get(s)->getOrderings()) {
+				TTimePoint tp1 = firstPoint(o), tp2 = secondPoint(o);
+				if ((tp1 + 1 != tp2 || (tp1 & 1) == 1) && times[tp2] <= times[tp1]) {
+					times[tp2] = times[tp1] + 1;
+					changed = true;
+				}
+			}
+		}
+	}
+	if (changed || times[0] != -1) return false;
+	for (TStep s = 1; s < numSteps; s++) {		// TILs start at time 0
+		if (planComponents->get(s)->action->isTIL && times[stepToStartPoint(s)] != 0)
+			return false;
+	}
+	return true;
+}
+
+// Sets the scheduled times in the plan (as in Z3Checker::updatePlan)
+void PlanValidator::updatePlan(Plan* p)
+{
+	for (TStep s = 0; s < planComponents->size(); s++) {
+		TTimePoint startPoint = stepToStartPoint(s), endPoint = startPoint + 1;
+		TFloatValue startTime = round3d(times[startPoint] / 1000.0);
+		TFloatValue endTime = round3d(times[endPoint] / 1000.0f);
+		Plan* pc = planComponents->get(s);
+		if (p == pc) {
+			p->setTime(startTime, endTime, p->fixedInit);
+		}
+		else {
+			if (abs(startTime - planComponents->getTime(startPoint)) > EPSILON / 2)
+				p->addPlanUpdate(startPoint, startTime);
+			if (abs(endTime - planComponents->getTime(endPoint)) > EPSILON / 2)
+				p->addPlanUpdate(endPoint, endTime);
+		}
+	}
+	p->timesVersion++;		// The cached components that include this plan must be recalculated
+}
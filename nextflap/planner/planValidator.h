@@ -0,0 +1,52 @@
+#ifndef PLAN_VALIDATOR_H
+#define PLAN_VALIDATOR_H
+
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Fast plan validity checking, used before calling Z3. */
+/* Without control variables, the values of the fluents */
+/* only depend on the constants of the task and on the  */
+/* fixed durations, so they are computed step by step   */
+/* and the numeric conditions are directly evaluated.   */
+/* The times are then scheduled as soon as possible     */
+/* through the difference constraints of the plan. When */
+/* a value cannot be computed, or a comparison is too   */
+/* close to be decided with floating point numbers, the */
+/* result is unknown and the plan must be checked by Z3.*/
+/********************************************************/
+
+#include <vector>
+#include "plan.h"
+#include "planComponents.h"
+
+enum ValidationResult { VR_VALID = 0, VR_INVALID = 1, VR_UNKNOWN = 2 };
+
+class PlanValidator {
+private:
+	PlanComponents* planComponents;
+	std::vector<double> values;				// Values of the fluents modified in each time point (NaN if unknown)
+	std::vector<unsigned int> valuesStart;	// Position in the values vector of the fluents of each time point
+	std::vector<double> duration;			// Duration of each step (NaN if it is not fixed)
+	std::vector<int> minDuration;			// Bounds of the duration of each step, in thousandths (as in Z3)
+	std::vector<int> maxDuration;
+	std::vector<int> times;					// Schedule of the time points, in thousandths
+
+	inline int intVal(TFloatValue n) { return (int)(n * 1000); };
+	double* getValue(TVariable var, TTimePoint tp);
+	double getProductorValue(TVariable var, TTimePoint tp);
+	double evaluate(SASNumericExpression& e, TTimePoint tp);
+	bool calculateDuration(Plan* p, TStep s);
+	bool applyEffects(std::vector<SASNumericEffect>& effects, TTimePoint tp);
+	ValidationResult checkCondition(SASNumericCondition& c, TTimePoint tp);
+	ValidationResult checkConditions(std::vector<SASNumericCondition>& conditions, TTimePoint tp);
+	ValidationResult calculateValues(Plan* p, TStep s);
+	bool schedule();
+	void updatePlan(Plan* p);
+
+public:
+	ValidationResult checkPlan(Plan* p, PlanComponents* planComponents);
+};
+
+#endif
@@ -19,7 +19,8 @@ bool Planner::emptySearchSpace()
 
 // Constructor
 Planner::Planner(SASTask* task, Plan* initialPlan, TState* initialState, bool forceAtEndConditions,
-	bool filterRepeatedStates, bool generateTrace, std::vector<SASAction*>* tilActions, ParsedTask* parsedTask)
+	bool filterRepeatedStates, bool generateTrace, std::vector<SASAction*>* tilActions, ParsedTask* parsedTask,
+	unsigned int orderingVariant, std::atomic<bool>* stopSearch, StateRegistry* stateRegistry)
 {
 	this->bestH = MAX_INT32;
 	this->parsedTask = parsedTask;
@@ -33,28 +34,43 @@ Planner::Planner(SASTask* task, Plan* initialPlan, TState* initialState, bool fo
 	this->expandedNodes = 0;
 	this->generateTrace = generateTrace;
 	this->tilActions = tilActions;
-	successors = new Successors(initialState, task, forceAtEndConditions, filterRepeatedStates, tilActions);
+	this->stopSearch = stopSearch;
+	this->memoryLimit = parsedTask->memoryLimit;
+	this->usedMemory = 0;
+	successors = new Successors(initialState, task, forceAtEndConditions, filterRepeatedStates, tilActions, stateRegistry);
+	successors->setExpansionThreads(parsedTask->expansionThreads);
+	checker = new Z3Checker(successors->getPlanComponents());
 	this->initialH = FLOAT_INFINITY;
 	this->solution = nullptr;
-	selector = new SearchQueue();
+	selector = new PlanSelector(orderingVariant, parsedTask->fifoTieBreaking, parsedTask->multiQueue,
+		successors->evaluator.informativeLandmarks());
+	successors->preferredOperators = selector->usesPreferredPlans();
+	successors->lazyEvaluation = parsedTask->lazyEvaluation;
 	successors->evaluator.calculateFrontierState(this->initialPlan);
-	/*
-	selector->addQueue(SEARCH_NRPG);
-	if (successors->evaluator.informativeLandmarks()) {	// Landmarks available
-		selector->addQueue(SEARCH_LAND);
-	}*/
 	selector->add(this->initialPlan);
 	successors->evaluator.evaluateInitialPlan(initialPlan);
 }
 
+// The plans are not deleted here, as they are released together with the search arena
+Planner::~Planner()
+{
+	delete checker;
+	delete successors;
+	delete selector;
+}
+
 // Starts the search
 Plan* Planner::plan(float bestMakespan)
 {
 	this->bestMakespan = bestMakespan;
 	while (solution == nullptr && this->selector->size() > 0) {
 		if (parsedTask->timeout > 0 && parsedTask->ellapsedTime() > parsedTask->timeout) break;
+		if (stopSearch != nullptr && stopSearch->load(std::memory_order_relaxed)) break;
 		searchStep();
 	}
+	if (debugFile != nullptr)
+		*debugFile << ";Heuristic cache: " << successors->evaluator.getCacheHits() << " hits, "
+			<< successors->evaluator.getCacheMisses() << " misses" << endl;
 	return solution;
 }
 
@@ -67,9 +83,8 @@ void Planner::clearSolution()
 
 // Checks if a plan is valid
 bool Planner::checkPlan(Plan* p) {
-	Z3Checker checker;
 	p->z3Checked = true;
-	bool valid = checker.checkPlan(p, false);
+	bool valid = checker->checkPlan(p, false);
 	return valid;
 }
 
@@ -98,6 +113,14 @@ void Planner::markChildrenAsInvalid(Plan* p) {
 // Makes one search step
 void Planner::searchStep() {
 	Plan* base = selector->poll();
+	if (base == nullptr) return;	// Only plans already expanded remained in the queues
+	if (base->stateId == NO_STATE) {	// Deferred evaluation
+		successors->evaluator.calculateFrontierState(base);
+		successors->evaluator.evaluate(base);
+		if (base->h >= MAX_UINT16) return;	// Dead end
+	}
+	if (bestMakespan < FLOAT_INFINITY && PrintPlan::getMakespan(base) > bestMakespan)
+		return;		// Worse than the last solution found (anytime search)
 #if _DEBUG
 	cout << "Base plan: " << base->id << ", " << base->action->name << "(G = " << base->g << ", H=" << base->h << ")" << endl;
 #endif
@@ -107,6 +130,7 @@ void Planner::searchStep() {
 			base->action->endNumCond.size() > 0) {
 			if (base->h <= 1) {
 				if (!checkPlan(base)) {	// Validity checking
+					base->invalid = true;
 					return;
 				}
 			}
@@ -150,4 +174,43 @@ void Planner::addSuccessors(Plan* base)
 		//cout << "* Successor: " << p->id << ", " << p->action->name << "(G = " << p->g << ", H=" << p->h << ")" << endl;
 		selector->add(p);
 	}
+	if (memoryLimit > 0) {
+		for (Plan* p : sucPlans)
+			usedMemory += p->getMemorySize();
+		usedMemory += sizeof(ArenaVector<Plan*>) + base->childPlans->capacity() * sizeof(Plan*);
+		if (usedMemory > memoryLimit && solution == nullptr)	// The ancestors of the solution must be kept
+			evictPlans();
+	}
+}
+
+// Bounded-memory search (SMA*-like): removes the worst open plans from the search tree until the used memory is
+// below the limit (with some margin, to avoid evicting plans after each expansion). When all the children of a
+// plan are evicted, the plan is reopened with a backed-up heuristic value, so they can be generated again
+void Planner::evictPlans()
+{
+	size_t target = memoryLimit - memoryLimit / MEMORY_EVICTION_MARGIN;
+	while (usedMemory > target) {
+		Plan* p = selector->evictWorst();
+		if (p == nullptr) break;
+		releaseMemory(p->getMemorySize());
+		Plan* parent = p->parentPlan;
+		if (parent != nullptr) {
+			parent->removeChild(p);
+			if (parent->childPlans->empty() && !parent->invalid)
+				reopenPlan(parent, p->h);
+		}
+		if (p->openLists == 0) delete p;	// Otherwise, it is deleted when it leaves the other queues
+	}
+}
+
+// Returns an expanded plan, whose children have been evicted, to the open list
+void Planner::reopenPlan(Plan* p, int childH)
+{
+	releaseMemory(sizeof(ArenaVector<Plan*>) + p->childPlans->capacity() * sizeof(Plan*));
+	arenaDelete(p->childPlans);
+	p->childPlans = nullptr;
+	if (childH > p->h) p->h = childH;
+	if (filterRepeatedStates && p->stateId < successors->visitedStates.size())
+		successors->visitedStates[p->stateId] = false;
+	selector->reopen(p);
 }
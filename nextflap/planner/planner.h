@@ -8,13 +8,19 @@
 /* Planning search.										*/
 /********************************************************/
 
+#include <atomic>
 #include "../parser/parsedTask.h"
 #include "../sas/sasTask.h"
 #include "state.h"
+#include "stateRegistry.h"
 #include "plan.h"
 #include "successors.h"
 #include "selector.h"
 
+#define MEMORY_EVICTION_MARGIN	10		// Evicts plans until the memory is 1/10 below the limit
+
+class Z3Checker;
+
 class Planner {
 private:
 	SASTask* task;
@@ -27,15 +33,19 @@ private:
 	Planner* parentPlanner;
 	unsigned int expandedNodes;
 	Successors* successors;
+	Z3Checker* checker;					// Plan validator (it keeps the constraints of the last plan checked)
 	std::vector<SASAction*>* tilActions;
 	float initialH;
 	Plan* solution;
 	std::vector<Plan*> sucPlans;
-	SearchQueue* selector;
+	PlanSelector* selector;
 	//clock_t startTime;
 	float bestMakespan;
 	int bestNumSteps;
 	int bestH;
+	std::atomic<bool>* stopSearch;		// Set by other search threads to stop this one (nullptr if not used)
+	size_t memoryLimit;					// Maximum memory for the plans (0 if there is no limit)
+	size_t usedMemory;					// Approximated memory used by the plans
 
 	bool emptySearchSpace();
 	void searchStep();
@@ -44,11 +54,15 @@ private:
 	bool checkPlan(Plan* p);
 	void markAsInvalid(Plan* p);
 	void markChildrenAsInvalid(Plan* p);
+	void evictPlans();
+	void reopenPlan(Plan* p, int childH);
+	inline void releaseMemory(size_t size) { usedMemory = usedMemory > size ? usedMemory - size : 0; }
 
 public:
 	Planner(SASTask* task, Plan* initialPlan, TState* initialState, bool forceAtEndConditions,
 		bool filterRepeatedStates, bool generateTrace, std::vector<SASAction*>* tilActions,
-		ParsedTask* parsedTask);
+		ParsedTask* parsedTask, unsigned int orderingVariant, std::atomic<bool>* stopSearch, StateRegistry* stateRegistry);
+	~Planner();
 	Plan* plan(float bestMakespan);
 	void clearSolution();
 };
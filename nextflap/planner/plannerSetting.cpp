@@ -13,24 +13,48 @@ PlannerSetting::PlannerSetting(SASTask* sTask) {
 	initialTime = clock();
 	this->task = sTask;
 	this->generateTrace = generateTrace;
-	createInitialPlan();
+	initialAction = createInitialAction();
+	createTILactions();
 	forceAtEndConditions = checkForceAtEndConditions();
 	filterRepeatedStates = checkRepeatedStates();
 	//if (!forceAtEndConditions) cout << "End conditions can be left unsupported" << endl;
 	//if (!filterRepeatedStates) cout << "Repeated states will not be pruned" << endl;
 	initialState = new TState(this->task);
+	std::vector<SASAction*> fictitiousActions(tilActions);
+	fictitiousActions.push_back(initialAction);
+	stateRegistry = new StateRegistry(task, fictitiousActions);
 	task->tilActions = !tilActions.empty();
-	this->planner = nullptr;
+	task->getListOfGoals();		// Computed in advance as it is shared by the search threads
+	this->portfolioSolution = nullptr;
+	this->distributedPlanner = nullptr;
+}
+
+// Releases the planners and all the memory used in the search (plans and states)
+PlannerSetting::~PlannerSetting() {
+	for (Planner* p : planners)
+		delete p;
+	if (distributedPlanner != nullptr) delete distributedPlanner;
+	delete stateRegistry;
+	delete initialState;		// Every object stored in the arena is destroyed before the release
+	Arena::releaseAll();
 }
 
 // Creates the initial empty plan that only contains the initial and the TIL fictitious actions
-void PlannerSetting::createInitialPlan() {
-	SASAction* initialAction = createInitialAction();
-	initialPlan = new Plan(initialAction, nullptr, 0, nullptr);
-	initialPlan->setDuration(EPSILON, EPSILON);
-	initialPlan->setTime(-EPSILON, 0, true);
-	initialPlan->addFluentIntervals();
-	initialPlan = createTILactions(initialPlan);
+Plan* PlannerSetting::createInitialPlan() {
+	Plan* result = new Plan(initialAction, nullptr, 0, nullptr);
+	result->setDuration(EPSILON, EPSILON);
+	result->setTime(-EPSILON, 0, true);
+	result->addFluentIntervals();
+	result->compact();
+	for (SASAction* a : tilActions) {
+		float timePoint = a->duration.conditions[0].exp.value;
+		result = new Plan(a, result, 0, nullptr);
+		result->setDuration(timePoint, timePoint);
+		result->setTime(0, timePoint, true);
+		result->addFluentIntervals();
+		result->compact();
+	}
+	return result;
 }
 
 // Creates and returns the initial fictitious action
@@ -69,6 +93,9 @@ SASAction* PlannerSetting::createFictitiousAction(float actionDuration, vector<u
 	duration.exp.type = 'N';	// Number (epsilon duration)
 	duration.exp.value = actionDuration;
 	a->duration.conditions.push_back(duration);
+	a->duration.constantDuration = true;			// Fictitious actions are not post-processed
+	a->duration.minDuration = a->duration.maxDuration = actionDuration;
+	a->duration.durationNeededInEffects = false;
 	for (unsigned int i = 0; i < varList.size(); i++) {
 		unsigned int varIndex = varList[i];
 		if (varIndex < task->variables.size()) {	//	Non-numeric effect
@@ -99,9 +126,8 @@ SASAction* PlannerSetting::createFictitiousAction(float actionDuration, vector<u
 	return a;
 }
 
-// Adds the fictitious TIL actions to the initial plan. Returns the resulting plan
-Plan* PlannerSetting::createTILactions(Plan* parentPlan) {
-	Plan* result = parentPlan;
+// Creates the fictitious TIL actions, which last from time 0 to the TIL time point
+void PlannerSetting::createTILactions() {
 	unordered_map<float, vector<unsigned int> > til;			// Time point -> variables modified at that time
 	for (unsigned int i = 0; i < task->variables.size(); i++) {	// Non-numeric effects
 		SASVariable& var = task->variables[i];
@@ -134,12 +160,7 @@ Plan* PlannerSetting::createTILactions(Plan* parentPlan) {
 		SASAction* a = createFictitiousAction(timePoint, it->second, timePoint, 
 			"#til" + to_string(timePoint), true, false);
 		tilActions.push_back(a);
-		result = new Plan(a, result, 0, nullptr);
-		result->setDuration(timePoint, timePoint);
-		result->setTime(0, timePoint, true);
-		result->addFluentIntervals();
 	}
-	return result;
 }
 
 bool PlannerSetting::checkForceAtEndConditions() {	// Check if it's required to leave at-end conditions not supported for some actions
@@ -183,13 +204,70 @@ bool PlannerSetting::checkRepeatedStates() {
 	return true;
 }
 
+// Creates one planner per search thread. Each one has its own copy of the initial plan
+void PlannerSetting::createPlanners(ParsedTask* parsedTask) {
+	unsigned int numThreads = parsedTask->numThreads > 1 ? parsedTask->numThreads : 1;
+	for (unsigned int i = 0; i < numThreads; i++) {
+		planners.push_back(new Planner(task, createInitialPlan(), initialState, forceAtEndConditions,
+			filterRepeatedStates, generateTrace, &tilActions, parsedTask, i, numThreads > 1 ? &stopSearch : nullptr,
+			stateRegistry));
+	}
+}
+
 Plan* PlannerSetting::plan(float bestMakespan, ParsedTask* parsedTask) {
-	if (planner == nullptr) {
-		planner = new Planner(task, initialPlan, initialState, forceAtEndConditions, filterRepeatedStates,
-			generateTrace, &tilActions, parsedTask);
+	if (parsedTask->distributedSearch && parsedTask->numThreads > 1) {
+		if (distributedPlanner == nullptr) {
+			distributedPlanner = new DistributedPlanner(task, createInitialPlan(), initialState, forceAtEndConditions,
+				filterRepeatedStates, &tilActions, parsedTask, parsedTask->numThreads, stateRegistry);
+		}
+		else {
+			distributedPlanner->clearSolution();
+		}
+		return distributedPlanner->plan(bestMakespan);
+	}
+	if (planners.empty()) {
+		createPlanners(parsedTask);
 	}
 	else {
-		planner->clearSolution();
+		for (Planner* planner : planners)
+			planner->clearSolution();
+	}
+	if (planners.size() == 1)
+		return planners[0]->plan(bestMakespan);
+	return portfolioSearch(bestMakespan);
+}
+
+// Runs all planners in parallel, each one with a different plan ordering. The first solution found stops the search
+Plan* PlannerSetting::portfolioSearch(float bestMakespan) {
+	stopSearch = false;
+	portfolioSolution = nullptr;
+	portfolioError = nullptr;
+	vector<thread> threads;
+	for (Planner* planner : planners)
+		threads.emplace_back(&PlannerSetting::portfolioThread, this, planner, bestMakespan);
+	for (thread& t : threads)
+		t.join();
+	if (portfolioError != nullptr)
+		rethrow_exception(portfolioError);
+	return portfolioSolution;
+}
+
+// Search thread of the portfolio. Solutions are already validated by the planner
+void PlannerSetting::portfolioThread(Planner* planner, float bestMakespan) {
+	try {
+		Plan* solution = planner->plan(bestMakespan);
+		if (solution != nullptr) {
+			lock_guard<mutex> lock(solutionMutex);
+			if (portfolioSolution == nullptr) {
+				portfolioSolution = solution;
+				stopSearch = true;
+			}
+		}
+	}
+	catch (...) {
+		lock_guard<mutex> lock(solutionMutex);
+		if (portfolioError == nullptr)
+			portfolioError = current_exception();
+		stopSearch = true;
 	}
-	return planner->plan(bestMakespan);
 }
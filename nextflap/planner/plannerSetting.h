@@ -12,31 +12,46 @@
 #include "state.h"
 #include "plan.h"
 #include "planner.h"
+#include "distributedPlanner.h"
 #include "../heuristics/rpg.h"
 #include <time.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <exception>
 
 class PlannerSetting {
 private:
 	SASTask* task;
 	clock_t initialTime;
 	bool generateTrace;
-	Plan* initialPlan;
+	SASAction* initialAction;
 	std::vector<SASAction*> tilActions;
 	bool forceAtEndConditions;
 	bool filterRepeatedStates;
 	TState* initialState;
-	Planner* planner;
+	StateRegistry* stateRegistry;		// Frontier states of all the search threads
+	std::vector<Planner*> planners;		// One planner per search thread
+	DistributedPlanner* distributedPlanner;
+	std::atomic<bool> stopSearch;
+	std::mutex solutionMutex;
+	Plan* portfolioSolution;
+	std::exception_ptr portfolioError;
 
-	void createInitialPlan();
+	Plan* createInitialPlan();
 	SASAction* createInitialAction();
 	SASAction* createFictitiousAction(float actionDuration, std::vector<unsigned int>& varList,
 		float timePoint, std::string name, bool isTIL, bool isGoal);
-	Plan* createTILactions(Plan* parentPlan);
+	void createTILactions();
 	bool checkForceAtEndConditions();	// Check if it's required to leave at-end conditions not supported for some actions
 	bool checkRepeatedStates();
+	void createPlanners(ParsedTask* parsedTask);
+	Plan* portfolioSearch(float bestMakespan);
+	void portfolioThread(Planner* planner, float bestMakespan);
 
 public:
 	PlannerSetting(SASTask* sTask);
+	~PlannerSetting();
 	Plan* plan(float bestMakespan, ParsedTask* parsedTask);
 };
 
@@ -24,8 +24,9 @@ std::string PrintPlan::printDurative(Plan* p, TControVarValues* cvarValues)
 	for (TTimePoint tp : linearizer.linearOrder) {
 		Plan* pc = planComponents.get(timePointToStep(tp));
 		if ((tp & 1) == 0 && !pc->isRoot() && !pc->action->isGoal) {
-			float duration = round3d(pc->endPoint.updatedTime) - round3d(pc->startPoint.updatedTime);
-			res += std::to_string(round3d(pc->startPoint.updatedTime - 0.001)) + ": ("
+			float startTime = planComponents.getTime(tp), endTime = planComponents.getTime(tp + 1);
+			float duration = round3d(endTime) - round3d(startTime);
+			res += std::to_string(round3d(startTime - 0.001)) + ": ("
 				+ actionName(pc->action);
 			if (cvarValues != nullptr && !pc->action->controlVars.empty()) {
 				std::vector<float> values = cvarValues->at(timePointToStep(tp));
@@ -39,8 +40,8 @@ std::string PrintPlan::printDurative(Plan* p, TControVarValues* cvarValues)
 				}
 			}
 			res += ") [" + std::to_string(round3d(duration)) + "]|";
-			if (pc->endPoint.updatedTime > makespan)
-				makespan = pc->endPoint.updatedTime;
+			if (endTime > makespan)
+				makespan = endTime;
 		}
 	}
 	//cout << ";Makespan: " << fixed << setprecision(3) << makespan << endl;
@@ -67,25 +68,25 @@ std::string PrintPlan::printPOP(Plan* p, TControVarValues* cvarValues)
 			// Search for orderings j -> i
 			for (int j = 0; j < ncomp; j++) {
 				Plan* opc = planComponents.get(j);
-				for (TOrdering o : opc->orderings) {
+				for (TOrdering o : opc->getOrderings()) {
 					TStep start = timePointToStep(firstPoint(o)), end = timePointToStep(secondPoint(o));
 					if (end == i) stepsBefore[start] = true;
 				}
 			}
 			// Causal links
-			for (TCausalLink cl : pc->startPoint.causalLinks) {
+			for (TCausalLink cl : pc->getCausalLinks(true)) {
 				TStep start = timePointToStep(cl.timePoint);
 				stepsBefore[start] = true;
 			}
-			for (TNumericCausalLink cl : pc->startPoint.numCausalLinks) {
+			for (TNumericCausalLink cl : pc->getNumericCausalLinks(true)) {
 				TStep start = timePointToStep(cl.timePoint);
 				stepsBefore[start] = true;
 			}
-			for (TCausalLink cl : pc->endPoint.causalLinks) {
+			for (TCausalLink cl : pc->getCausalLinks(false)) {
 				TStep start = timePointToStep(cl.timePoint);
 				stepsBefore[start] = true;
 			}
-			for (TNumericCausalLink cl : pc->endPoint.numCausalLinks) {
+			for (TNumericCausalLink cl : pc->getNumericCausalLinks(false)) {
 				TStep start = timePointToStep(cl.timePoint);
 				stepsBefore[start] = true;
 			}
@@ -132,8 +133,8 @@ float PrintPlan::getMakespan(Plan* p)
 	float makespan = 0;
 	for (TTimePoint tp : linearizer.linearOrder) {
 		Plan* pc = planComponents.get(timePointToStep(tp));
-		if ((tp & 1) == 0 && !pc->isRoot() && !pc->action->isGoal && pc->endPoint.updatedTime > makespan)
-			makespan = pc->endPoint.updatedTime;
+		if ((tp & 1) == 0 && !pc->isRoot() && !pc->action->isGoal && planComponents.getTime(tp + 1) > makespan)
+			makespan = planComponents.getTime(tp + 1);
 	}
 	return makespan;
 }
@@ -151,15 +152,15 @@ void PrintPlan::rawPrint(Plan* p, SASTask* task)
 		p = planComponents[step];
 		cout << "Plan component " << step << endl;
 		cout << "  (" << stepToStartPoint(step) << ") " << p->action->name << " (" << stepToEndPoint(step) << ")" << endl;
-		for (TOrdering o : p->orderings) 
+		for (TOrdering o : p->getOrderings()) 
 			cout << "  " << firstPoint(o) << " -> " << secondPoint(o) << endl;
-		for (TCausalLink cl : p->startPoint.causalLinks) cout << "  " << cl.timePoint << " --> start, " <<
+		for (TCausalLink cl : p->getCausalLinks(true)) cout << "  " << cl.timePoint << " --> start, " <<
 			task->variables[task->getVariableIndex(cl.varVal)].name << "=" << task->values[task->getValueIndex(cl.varVal)].name << endl;
-		for (TNumericCausalLink cl : p->startPoint.numCausalLinks) 
+		for (TNumericCausalLink cl : p->getNumericCausalLinks(true)) 
 			cout << "  " << cl.timePoint << " --> start, " << task->numVariables[cl.var].name << endl;
-		for (TCausalLink cl : p->endPoint.causalLinks) cout << "  " << cl.timePoint << " --> end, " <<
+		for (TCausalLink cl : p->getCausalLinks(false)) cout << "  " << cl.timePoint << " --> end, " <<
 			task->variables[task->getVariableIndex(cl.varVal)].name << "=" << task->values[task->getValueIndex(cl.varVal)].name << endl;
-		for (TNumericCausalLink cl : p->endPoint.numCausalLinks) 
+		for (TNumericCausalLink cl : p->getNumericCausalLinks(false)) 
 			cout << "  " << cl.timePoint << " --> end, " << task->numVariables[cl.var].name << endl;
 	}
 #endif // _DEBUG
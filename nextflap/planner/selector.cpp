@@ -8,58 +8,262 @@
 #include "selector.h"
 using namespace std;
 
+/*******************************************/
+/* PlanOrdering                            */
+/*******************************************/
+
+// Variant 0 is the default ordering. The rest are used to diversify the portfolio search
+PlanOrdering::PlanOrdering(unsigned int variant, bool landmarks) {
+	hTieBreaking = variant > 0;
+	switch (variant % 4) {
+	case 0:		// Default: g + 2h, or g + h + 2hLand if landmarks are informative
+		gWeight = 1;
+		hWeight = landmarks ? 1 : 2;
+		hLandWeight = landmarks ? 2 : 0;
+		break;
+	case 1:		// Greedier: g + 3h
+		gWeight = 1;
+		hWeight = 3;
+		hLandWeight = landmarks ? 2 : 0;
+		break;
+	case 2:		// Less greedy: g + h
+		gWeight = 1;
+		hWeight = 1;
+		hLandWeight = landmarks ? 1 : 0;
+		break;
+	default:	// Pure greedy best-first search
+		gWeight = 0;
+		hWeight = 1;
+		hLandWeight = landmarks ? 1 : 0;
+		break;
+	}
+	hWeight += variant / 4;
+}
+
+PlanOrdering::PlanOrdering(int gWeight, int hWeight, int hLandWeight, bool hTieBreaking) {
+	this->gWeight = gWeight;
+	this->hWeight = hWeight;
+	this->hLandWeight = hLandWeight;
+	this->hTieBreaking = hTieBreaking;
+}
+
 /*******************************************/
 /* SearchQueue                             */
 /*******************************************/
 
-SearchQueue::SearchQueue() {
-	pq.reserve(INITIAL_PQ_CAPACITY);
-	pq.push_back(nullptr);	// Position 0 empty
+SearchQueue::SearchQueue(unsigned int orderingVariant, bool landmarks, bool fifoTieBreaking) :
+	ordering(orderingVariant, landmarks) {
+	fifo = fifoTieBreaking;
+	minF = 0;
+	numPlans = 0;
+}
+
+SearchQueue::SearchQueue(PlanOrdering planOrdering, bool fifoTieBreaking) : ordering(planOrdering) {
+	fifo = fifoTieBreaking;
+	minF = 0;
+	numPlans = 0;
 }
 
 // Adds a new plan to the list of open nodes
 void SearchQueue::add(Plan* p) {
-	unsigned int gap = (unsigned int)pq.size();
-	uint32_t parent;
-	pq.push_back(nullptr);
-	while (gap > 1 && p->compare(pq[gap >> 1]) < 0) {
-		parent = gap >> 1;
-		pq[gap] = pq[parent];
-		gap = parent;
-	}
-	pq[gap] = p;
+	unsigned int f = getF(p), h = getH(p);
+	if (f < MAX_BUCKET_F && f >= buckets.size()) buckets.resize(f + 1);
+	FBucket& fb = getFBucket(f);
+	if (h >= fb.hBuckets.size()) fb.hBuckets.resize(h + 1);
+	fb.hBuckets[h].plans.push_back(p);
+	if (fb.numPlans == 0 || h < fb.minH) fb.minH = h;
+	fb.numPlans++;
+	if (numPlans == 0 || f < minF) minF = f;
+	numPlans++;
+}
+
+// Returns the bucket of the best plans
+PlanBucket& SearchQueue::getFirstBucket() {
+	FBucket& fb = getFBucket(minF);
+	return fb.hBuckets[fb.minH];
+}
+
+// Returns the best plan in the queue of open nodes
+Plan* SearchQueue::peek() {
+	PlanBucket& b = getFirstBucket();
+	return fifo ? b.plans[b.first] : b.plans.back();
 }
 
 // Removes and returns the best plan in the queue of open nodes
 Plan* SearchQueue::poll() {
-	Plan* best = pq[1];
-	if (pq.size() > 2) {
-		pq[1] = pq.back();
-		pq.pop_back();
-		heapify(1);
+	FBucket& fb = getFBucket(minF);
+	PlanBucket& b = fb.hBuckets[fb.minH];
+	Plan* best;
+	if (fifo) {
+		best = b.plans[b.first++];
+		if (b.empty()) {
+			b.plans.clear();
+			b.first = 0;
+		}
+		else if (b.first >= FIFO_COMPACT_SIZE && 2 * b.first >= b.plans.size()) {	// Release the space of the removed plans
+			b.plans.erase(b.plans.begin(), b.plans.begin() + b.first);
+			b.first = 0;
+		}
 	}
-	else if (pq.size() > 1) pq.pop_back();
+	else {
+		best = b.plans.back();
+		b.plans.pop_back();
+	}
+	numPlans--;
+	fb.numPlans--;
+	updateFirstBucket();
 	return best;
 }
 
-// Repairs the order in the priority queue
-void SearchQueue::heapify(unsigned int gap) {
-	Plan* aux = pq[gap];
-	unsigned int child = gap << 1;
-	while (child < pq.size()) {
-		if (child != pq.size() - 1 && pq[child + 1]->compare(pq[child]) < 0)
-			child++;
-		if (pq[child]->compare(aux) < 0) {
-			pq[gap] = pq[child];
-			gap = child;
-			child = gap << 1;
-		}
-		else break;
+// Moves minF and minH to the first non-empty bucket after a removal
+void SearchQueue::updateFirstBucket() {
+	if (numPlans == 0) return;
+	while (minF < buckets.size() && buckets[minF].numPlans == 0) minF++;
+	if (minF >= buckets.size()) minF = MAX_BUCKET_F;	// Only dead ends are left
+	FBucket& fb = getFBucket(minF);
+	while (fb.hBuckets[fb.minH].empty()) fb.minH++;
+}
+
+// Removes and returns the worst plan in the queue of open nodes (the last one added with the highest key)
+Plan* SearchQueue::pollWorst() {
+	if (overflow.numPlans == 0) {
+		while (buckets.back().numPlans == 0) buckets.pop_back();
+	}
+	FBucket& fb = overflow.numPlans > 0 ? overflow : buckets.back();
+	while (fb.hBuckets.back().empty()) fb.hBuckets.pop_back();
+	PlanBucket& b = fb.hBuckets.back();
+	Plan* worst = b.plans.back();
+	b.plans.pop_back();
+	if (b.empty()) {
+		b.plans.clear();
+		b.first = 0;
 	}
-	pq[gap] = aux;
+	numPlans--;
+	fb.numPlans--;
+	updateFirstBucket();
+	return worst;
 }
 
 void SearchQueue::clear() {
-	pq.clear();
-	pq.push_back(nullptr);	// Position 0 empty
+	buckets.clear();
+	overflow = FBucket();
+	minF = 0;
+	numPlans = 0;
+}
+
+/*******************************************/
+/* PlanSelector                            */
+/*******************************************/
+
+// If multiQueue is false, only the main queue is used
+PlanSelector::PlanSelector(unsigned int orderingVariant, bool fifoTieBreaking, bool multiQueue, bool landmarks) {
+	queues.push_back(new SearchQueue(orderingVariant, landmarks, fifoTieBreaking));
+	preferredQueue = -1;
+	if (multiQueue) {
+		queues.push_back(new SearchQueue(PlanOrdering(0, 1, 0, false), fifoTieBreaking));
+		heuristics.push_back(SEARCH_NRPG);
+		if (landmarks) {
+			queues.push_back(new SearchQueue(PlanOrdering(0, 0, 1, true), fifoTieBreaking));
+			heuristics.push_back(SEARCH_LAND);
+		}
+		preferredQueue = (int)queues.size();
+		queues.push_back(new SearchQueue(PlanOrdering(0, 1, 0, false), fifoTieBreaking));
+	}
+	priority.resize(queues.size(), 0);
+	bestH.resize(heuristics.size(), MAX_INT32);
+}
+
+PlanSelector::~PlanSelector() {
+	for (SearchQueue* q : queues)
+		delete q;
+}
+
+// Adds a new plan to the queues. The preferred queue only stores the preferred plans
+void PlanSelector::add(Plan* p) {
+	for (unsigned int i = 0; i < queues.size(); i++) {
+		if ((int)i != preferredQueue || p->preferred) {
+			queues[i]->add(p);
+			p->openLists++;
+		}
+	}
+	for (unsigned int i = 0; i < heuristics.size(); i++) {
+		int h = p->getH(heuristics[i]);
+		if (h < bestH[i]) {
+			if (bestH[i] != MAX_INT32) boostPreferredQueue();
+			bestH[i] = h;
+		}
+	}
+}
+
+// Gives extra turns to the preferred queue
+void PlanSelector::boostPreferredQueue() {
+	if (preferredQueue >= 0)
+		priority[preferredQueue] -= PREFERRED_BOOST;
+}
+
+// Removes and returns the best plan of the next queue (nullptr if there are no more plans to expand)
+Plan* PlanSelector::poll() {
+	if (queues.size() == 1) {
+		if (queues[0]->size() == 0) return nullptr;
+		Plan* p = queues[0]->poll();
+		p->openLists--;
+		return p;
+	}
+	while (true) {
+		int best = -1;
+		for (unsigned int i = 0; i < queues.size(); i++) {
+			if (queues[i]->size() > 0 && (best == -1 || priority[i] < priority[best]))
+				best = i;
+		}
+		if (best == -1) return nullptr;
+		priority[best]++;
+		Plan* p = queues[best]->poll();
+		p->openLists--;
+		if (p->evicted) {
+			if (p->openLists == 0) delete p;
+		}
+		else if (!p->expanded() && !p->invalid)
+			return p;
+	}
+}
+
+// Removes the worst plan of the main queue and marks it as evicted. It returns nullptr if the main queue is empty
+Plan* PlanSelector::evictWorst() {
+	while (queues[0]->size() > 0) {
+		Plan* p = queues[0]->pollWorst();
+		p->openLists--;
+		if (p->evicted) {
+			if (p->openLists == 0) delete p;
+		}
+		else if (!p->expanded() && !p->invalid) {
+			p->evicted = true;
+			return p;
+		}
+	}
+	return nullptr;
+}
+
+// Returns an expanded plan to the main queue. If it is still stored in another queue, it is not added again
+void PlanSelector::reopen(Plan* p) {
+	if (p->openLists == 0) {
+		queues[0]->add(p);
+		p->openLists++;
+	}
+}
+
+// Number of plans in the queues. A plan stored in several queues is counted several times
+int PlanSelector::size() {
+	int n = 0;
+	for (SearchQueue* q : queues)
+		n += q->size();
+	return n;
+}
+
+void PlanSelector::clear() {
+	for (unsigned int i = 0; i < queues.size(); i++) {
+		queues[i]->clear();
+		priority[i] = 0;
+	}
+	for (unsigned int i = 0; i < bestH.size(); i++)
+		bestH[i] = MAX_INT32;
 }
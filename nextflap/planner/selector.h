@@ -11,21 +11,111 @@
 #include <vector>
 #include "plan.h"
 
+// Evaluation function to sort the open plans: f = gWeight*g + hWeight*h + hLandWeight*hLand
+class PlanOrdering {
+public:
+	int gWeight;
+	int hWeight;
+	int hLandWeight;
+	bool hTieBreaking;		// Ties in f are broken in favour of the plan with the lowest h
+
+	PlanOrdering(unsigned int variant, bool landmarks);	// Landmarks: true if they are informative for the task
+	PlanOrdering(int gWeight, int hWeight, int hLandWeight, bool hTieBreaking);
+	inline int getF(Plan* p) { return gWeight * p->g + hWeight * p->h + hLandWeight * p->hLand; }
+	inline int compare(Plan* p1, Plan* p2) {
+		int v1 = getF(p1);
+		int v2 = getF(p2);
+		if (v1 < v2) return -1;
+		if (v1 > v2) return 1;
+		if (hTieBreaking) {
+			if (p1->h < p2->h) return -1;
+			if (p1->h > p2->h) return 1;
+		}
+		return 0;
+	}
+};
+
+// Plans with the same key in the open list
+class PlanBucket {
+public:
+	std::vector<Plan*> plans;
+	unsigned int first;		// Position of the first plan (FIFO tie-breaking)
+
+	PlanBucket() { first = 0; }
+	inline bool empty() { return first == plans.size(); }
+};
+
+// Plans with the same f value. If h is used for tie-breaking, they are classified by h
+class FBucket {
+public:
+	std::vector<PlanBucket> hBuckets;
+	unsigned int minH;		// First non-empty h bucket
+	unsigned int numPlans;
+
+	FBucket() { minH = 0; numPlans = 0; }
+};
+
+// Open list of plans. As f values are small integers, plans are stored in buckets (f, h) instead of a heap
 class SearchQueue {
 private:
-	const static unsigned int INITIAL_PQ_CAPACITY = 8192;
-	std::vector<Plan*> pq;
+	const static unsigned int MAX_BUCKET_F = 65535;		// Plans with this or greater f values (dead ends) are stored
+	const static unsigned int MAX_BUCKET_H = 1023;		// together in the overflow bucket
+	const static unsigned int FIFO_COMPACT_SIZE = 1024;
+	std::vector<FBucket> buckets;	// Only grows up to the greatest f value that is not a dead end
+	FBucket overflow;
+	unsigned int minF;		// First non-empty f bucket (MAX_BUCKET_F if it is the overflow bucket)
+	unsigned int numPlans;
+	PlanOrdering ordering;
+	bool fifo;				// Ties are broken in FIFO (true) or LIFO (false) order
+
+	inline unsigned int getF(Plan* p) {
+		int f = ordering.getF(p);
+		return f < 0 ? 0 : (f > (int)MAX_BUCKET_F ? MAX_BUCKET_F : (unsigned int)f);
+	}
+	inline unsigned int getH(Plan* p) {
+		if (!ordering.hTieBreaking || p->h < 0) return 0;
+		return p->h > (int)MAX_BUCKET_H ? MAX_BUCKET_H : (unsigned int)p->h;
+	}
+	inline FBucket& getFBucket(unsigned int f) { return f < MAX_BUCKET_F ? buckets[f] : overflow; }
+	PlanBucket& getFirstBucket();
+	void updateFirstBucket();
+
+public:
+	SearchQueue(unsigned int orderingVariant, bool landmarks, bool fifoTieBreaking);
+	SearchQueue(PlanOrdering planOrdering, bool fifoTieBreaking);
+	void add(Plan* p);
+	Plan* poll();
+	Plan* pollWorst();
+	Plan* peek();
+	inline int size() { return (int)numPlans; }
+	void clear();
+};
+
+// Open list made up of several queues which are selected alternately: the main one (sorted by the plan ordering),
+// greedy queues for h and hLand, and a queue of preferred plans. A plan can be stored in several queues, so the
+// plans already expanded or invalid are skipped when they are polled. Evicted plans are deleted when they are
+// removed from the last queue
+class PlanSelector {
+private:
+	const static int PREFERRED_BOOST = 1000;	// Extra turns of the preferred queue when the search makes progress
+	std::vector<SearchQueue*> queues;
+	std::vector<int> priority;					// The non-empty queue with the lowest value is selected next
+	std::vector<int> heuristics;				// Heuristic (SEARCH_NRPG or SEARCH_LAND) used to detect progress
+	std::vector<int> bestH;						// Best value found for each heuristic
+	int preferredQueue;							// Index of the queue of preferred plans (-1 if not used)
 
-	void heapify(unsigned int gap);
+	void boostPreferredQueue();
 
 public:
-	SearchQueue();
+	PlanSelector(unsigned int orderingVariant, bool fifoTieBreaking, bool multiQueue, bool landmarks);
+	~PlanSelector();
 	void add(Plan* p);
 	Plan* poll();
-	inline Plan* peek() { return pq[1]; }
-	inline int size() { return (int)pq.size() - 1; }
-	inline Plan* getPlanAt(unsigned int i) { return pq[i]; }
+	Plan* evictWorst();
+	void reopen(Plan* p);
+	int size();
 	void clear();
+	inline bool usesPreferredPlans() { return preferredQueue >= 0; }
 };
 
 #endif // !SELECTOR_H
@@ -11,12 +11,18 @@ using namespace std;
 TState::TState(unsigned int numSASVars, unsigned int numNumVars) {
 	this->numSASVars = numSASVars;
 	this->numNumVars = numNumVars;
-	state = new TValue[numSASVars];
-	minState = new TFloatValue[numNumVars];
-	maxState = new TFloatValue[numNumVars];
+	generation = Arena::getGeneration();
+	state = (TValue*)Arena::allocate(numSASVars * sizeof(TValue));		// States are stored in the search arena
+	minState = (TFloatValue*)Arena::allocate(numNumVars * sizeof(TFloatValue));
+	maxState = (TFloatValue*)Arena::allocate(numNumVars * sizeof(TFloatValue));
 }
 
 TState::TState(SASTask* task) : TState(task->variables.size(), task->numVariables.size()) {	// Create the initial state
+	setInitialState(task);
+}
+
+// Copies the values of the initial state
+void TState::setInitialState(SASTask* task) {
 	for (unsigned int i = 0; i < numSASVars; i++) {
 		this->state[i] = task->initialState[i];
 	}
@@ -26,7 +32,7 @@ TState::TState(SASTask* task) : TState(task->variables.size(), task->numVariable
 }
 
 TState::~TState() {
-	delete[] state;
-	delete[] minState;
-	delete[] maxState;
+	Arena::deallocate(state, numSASVars * sizeof(TValue), generation);	// Ignored if the arena was released
+	Arena::deallocate(minState, numNumVars * sizeof(TFloatValue), generation);
+	Arena::deallocate(maxState, numNumVars * sizeof(TFloatValue), generation);
 }
@@ -9,8 +9,12 @@
 /********************************************************/
 
 #include "../utils/utils.h"
+#include "../utils/arena.h"
 #include "../sas/sasTask.h"
 
+using TStateId = uint32_t;				// Identifier of a state in the registry
+const TStateId NO_STATE = MAX_UNSIGNED_INT;
+
 class TState {
 public:
 	unsigned int numSASVars;	// Number of SAS variables
@@ -18,27 +22,18 @@ public:
 	TValue* state;				// Values of the SAS variables in the state
 	TFloatValue* minState;		// Minimum values of the numeric variables in the state
 	TFloatValue* maxState;		// Maximum values of the numeric variables in the state
+	unsigned int generation;	// Arena generation in which the arrays were allocated
 
 	TState(unsigned int numSASVars, unsigned int numNumVars);
 	TState(SASTask* task);
 	~TState();
-	inline uint64_t getCode() {
-		uint64_t code = 0;
-		for (unsigned int i = 0; i < numSASVars; i++)
-			code = 31 * code + state[i];
-		for (unsigned int i = 0; i < numNumVars; i++)
-			code = 31 * code + ((uint64_t)(100 * (minState[i] + maxState[i])));
-		return code;
-	}
-	inline bool compareTo(TState* s) {
-		for (unsigned int i = 0; i < numNumVars; i++) {
-			if (abs(minState[i] - s->minState[i]) >= EPSILON) return false;
-			if (abs(maxState[i] - s->maxState[i]) >= EPSILON) return false;
-		}
-		for (unsigned int i = 0; i < numSASVars; i++) {
-			if (state[i] != s->state[i]) return false;
-		}
-		return true;
+	void setInitialState(SASTask* task);
+	static inline void* operator new(size_t size) { return Arena::allocate(size); }
+	static inline void operator delete(void* p, size_t size) { Arena::deallocate(p, size); }	// If the constructor throws
+	static inline void operator delete(TState* s, std::destroying_delete_t) {	// Nothing is freed if the arena was released
+		unsigned int generation = s->generation;
+		s->~TState();
+		Arena::deallocate(s, sizeof(TState), generation);
 	}
 	TFloatValue sumNumValues() {
 		TFloatValue sum = 0;
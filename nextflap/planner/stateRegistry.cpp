@@ -0,0 +1,197 @@
+#include "stateRegistry.h"
+#include <algorithm>
+
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Registry of the frontier states reached in the       */
+/* search. States are bit-packed, stored only once in a */
+/* contiguous pool and identified by a 32-bit id. The   */
+/* lookup uses Zobrist hash codes. The registry is      */
+/* split in shards by hash code, each one with its own  */
+/* lock, so the search threads rarely wait each other.  */
+/********************************************************/
+
+using namespace std;
+
+#define INITIAL_SHARD_BUCKETS	64
+
+// Pseudo-random generator for the Zobrist keys (splitmix64, fixed seed so the search is deterministic)
+static uint64_t nextZobristKey(uint64_t& seed)
+{
+	uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+// Constructor. The domain of each variable includes all the values it can take in the search
+StateRegistry::StateRegistry(SASTask* task, std::vector<SASAction*>& fictitiousActions)
+{
+	numSASVars = (unsigned int)task->variables.size();
+	numNumVars = (unsigned int)task->numVariables.size();
+	vector<vector<TValue> > domains(numSASVars);
+	for (unsigned int i = 0; i < numSASVars; i++) {
+		for (unsigned int v : task->variables[i].possibleValues)
+			domains[i].push_back((TValue)v);
+		domains[i].push_back(task->initialState[i]);
+	}
+	for (SASAction& a : task->actions)
+		addDomainValues(&a, domains);
+	for (SASAction* a : fictitiousActions)
+		addDomainValues(a, domains);
+	vars.resize(numSASVars);
+	uint64_t seed = 0;
+	unsigned int word = 0, usedBits = 0;
+	for (unsigned int i = 0; i < numSASVars; i++) {
+		vector<TValue>& d = domains[i];
+		sort(d.begin(), d.end());
+		d.erase(unique(d.begin(), d.end()), d.end());
+		PackedVariable& pv = vars[i];
+		pv.values = d;
+		pv.minValue = d[0];
+		pv.localIndex.resize(d.back() - d[0] + 1, MAX_UINT16);
+		for (unsigned int j = 0; j < d.size(); j++)
+			pv.localIndex[d[j] - d[0]] = (uint16_t)j;
+		pv.keyOffset = (unsigned int)valueKeys.size();
+		for (unsigned int j = 0; j < pv.localIndex.size(); j++)
+			valueKeys.push_back(nextZobristKey(seed));
+		unsigned int bits = 0;
+		while ((1U << bits) < d.size()) bits++;
+		if (usedBits + bits > 64) {		// Variables do not cross word boundaries
+			word++;
+			usedBits = 0;
+		}
+		pv.word = word;
+		pv.shift = usedBits;
+		pv.mask = bits == 0 ? 0 : ((~0ULL) >> (64 - bits));
+		usedBits += bits;
+	}
+	sasWords = numSASVars == 0 || usedBits == 0 ? word : word + 1;
+	stateWords = sasWords + numNumVars;	// Min. and max. values of a numeric variable share a word
+	if (stateWords == 0) stateWords = 1;
+	for (unsigned int i = 0; i < numNumVars; i++)
+		numericKeys.push_back(nextZobristKey(seed));
+	for (StateRegistryShard& shard : shards) {
+		shard.buckets.resize(INITIAL_SHARD_BUCKETS, NO_STATE);
+		shard.numStates = 0;
+	}
+}
+
+// Adds the values assigned by the action effects to the domains of the variables
+void StateRegistry::addDomainValues(SASAction* a, std::vector<std::vector<TValue> >& domains)
+{
+	for (SASCondition& c : a->startEff)
+		domains[c.var].push_back((TValue)c.value);
+	for (SASCondition& c : a->endEff)
+		domains[c.var].push_back((TValue)c.value);
+	for (SASConditionalEffect& ce : a->conditionalEff) {
+		for (SASCondition& c : ce.startEff)
+			domains[c.var].push_back((TValue)c.value);
+		for (SASCondition& c : ce.endEff)
+			domains[c.var].push_back((TValue)c.value);
+	}
+}
+
+// Bit-packs a state. The numeric values are quantized, so the states that only differ in rounding errors are the same
+void StateRegistry::pack(TState* s, uint64_t* dest)
+{
+	for (unsigned int i = 0; i < stateWords; i++)
+		dest[i] = 0;
+	for (unsigned int i = 0; i < numSASVars; i++) {
+		PackedVariable& pv = vars[i];
+		TValue v = s->state[i];
+		uint16_t index = v < pv.minValue || (size_t)(v - pv.minValue) >= pv.localIndex.size() ? MAX_UINT16 : pv.localIndex[v - pv.minValue];
+		if (index == MAX_UINT16)
+			throwError("Value " + to_string(v) + " out of the domain of variable " + to_string(i));
+		dest[pv.word] |= ((uint64_t)index) << pv.shift;
+	}
+	for (unsigned int i = 0; i < numNumVars; i++) {
+		uint32_t minBits, maxBits;
+		TFloatValue minValue = quantize(s->minState[i]), maxValue = quantize(s->maxState[i]);
+		memcpy(&minBits, &minValue, sizeof(uint32_t));
+		memcpy(&maxBits, &maxValue, sizeof(uint32_t));
+		dest[sasWords + i] = ((uint64_t)maxBits << 32) | minBits;
+	}
+}
+
+// Zobrist hash code of a state. The evaluator updates it incrementally as the plan effects are applied
+uint64_t StateRegistry::getHash(TState* s)
+{
+	uint64_t h = 0;
+	for (unsigned int i = 0; i < numSASVars; i++)
+		h ^= getValueKey(i, s->state[i]);
+	for (unsigned int i = 0; i < numNumVars; i++)
+		h ^= getNumericKey(i, s->minState[i], s->maxState[i]);
+	return h;
+}
+
+// Doubles the size of the hash table of a shard
+void StateRegistry::growHashTable(StateRegistryShard& shard)
+{
+	shard.buckets.assign(shard.buckets.size() * 2, NO_STATE);
+	size_t mask = shard.buckets.size() - 1;
+	for (TStateId index = 0; index < shard.numStates; index++) {
+		size_t b = shard.stateHashes[index] & mask;
+		while (shard.buckets[b] != NO_STATE) b = (b + 1) & mask;
+		shard.buckets[b] = index;
+	}
+}
+
+// Returns the id of the state, registering it if it is new. The highest bits of the hash code select the shard,
+// as the lowest ones select the bucket
+TStateId StateRegistry::insert(TState* s, uint64_t hash)
+{
+	static thread_local vector<uint64_t> packed;
+	packed.resize(stateWords);
+	pack(s, packed.data());
+	unsigned int shardIndex = (unsigned int)(hash >> (64 - REGISTRY_SHARD_BITS));
+	StateRegistryShard& shard = shards[shardIndex];
+	lock_guard<mutex> lock(shard.mtx);
+	if (((size_t)shard.numStates + 1) * 2 > shard.buckets.size())
+		growHashTable(shard);
+	size_t mask = shard.buckets.size() - 1, b = hash & mask;
+	while (shard.buckets[b] != NO_STATE) {
+		TStateId index = shard.buckets[b];
+		if (shard.stateHashes[index] == hash &&
+			memcmp(&(shard.pool[(size_t)index * stateWords]), packed.data(), stateWords * sizeof(uint64_t)) == 0)
+			return (index << REGISTRY_SHARD_BITS) | shardIndex;		// Repeated state
+		b = (b + 1) & mask;
+	}
+	if (shard.numStates == (NO_STATE >> REGISTRY_SHARD_BITS))
+		throwError("Too many states in the registry");
+	TStateId index = shard.numStates++;
+	shard.pool.insert(shard.pool.end(), packed.begin(), packed.end());
+	shard.stateHashes.push_back(hash);
+	shard.buckets[b] = index;
+	return (index << REGISTRY_SHARD_BITS) | shardIndex;
+}
+
+// Copies a registered state into s
+void StateRegistry::unpack(TStateId id, TState* s)
+{
+	StateRegistryShard& shard = shards[id & (REGISTRY_NUM_SHARDS - 1)];
+	lock_guard<mutex> lock(shard.mtx);		// The pool can be reallocated by an insertion
+	const uint64_t* packed = &(shard.pool[(size_t)(id >> REGISTRY_SHARD_BITS) * stateWords]);
+	for (unsigned int i = 0; i < numSASVars; i++) {
+		PackedVariable& pv = vars[i];
+		s->state[i] = pv.values[(packed[pv.word] >> pv.shift) & pv.mask];
+	}
+	for (unsigned int i = 0; i < numNumVars; i++) {
+		uint32_t minBits = (uint32_t)packed[sasWords + i], maxBits = (uint32_t)(packed[sasWords + i] >> 32);
+		memcpy(&(s->minState[i]), &minBits, sizeof(uint32_t));
+		memcpy(&(s->maxState[i]), &maxBits, sizeof(uint32_t));
+	}
+}
+
+// Number of different states registered
+TStateId StateRegistry::size()
+{
+	TStateId numStates = 0;
+	for (StateRegistryShard& shard : shards) {
+		lock_guard<mutex> lock(shard.mtx);
+		numStates += shard.numStates;
+	}
+	return numStates;
+}
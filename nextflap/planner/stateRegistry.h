@@ -0,0 +1,95 @@
+#ifndef STATE_REGISTRY_H
+#define STATE_REGISTRY_H
+
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Registry of the frontier states reached in the       */
+/* search. States are bit-packed, stored only once in a */
+/* contiguous pool and identified by a 32-bit id. The   */
+/* lookup uses Zobrist hash codes. The registry is      */
+/* split in shards by hash code, each one with its own  */
+/* lock, so the search threads rarely wait each other.  */
+/********************************************************/
+
+#include <mutex>
+#include <cstring>
+#include <cmath>
+#include "../sas/sasTask.h"
+#include "state.h"
+
+#define REGISTRY_SHARD_BITS		6		// 64 shards. The shard of a state is stored in the lowest bits of its id
+#define REGISTRY_NUM_SHARDS		(1 << REGISTRY_SHARD_BITS)
+#define MAX_QUANTIZED_VALUE		1e6f	// Larger values have no thousandths in single precision
+
+// Position of a SAS variable in the packed state
+class PackedVariable {
+public:
+	unsigned int word;					// Index of the 64-bit word that contains the variable
+	unsigned int shift;
+	uint64_t mask;
+	TValue minValue;					// Lowest value in the domain of the variable
+	std::vector<uint16_t> localIndex;	// Value - minValue -> index in the domain (MAX_UINT16 if not in the domain)
+	std::vector<TValue> values;			// Index in the domain -> value
+	unsigned int keyOffset;				// Position of the Zobrist keys of the variable values (value - minValue)
+};
+
+// States whose hash code starts with the same bits
+class StateRegistryShard {
+public:
+	std::vector<uint64_t> pool;			// Packed states, one after another (stateWords each)
+	std::vector<uint64_t> stateHashes;	// Hash code of each state in the shard
+	std::vector<TStateId> buckets;		// Open-addressing hash table of local indexes (linear probing, no deletions)
+	TStateId numStates;
+	std::mutex mtx;
+};
+
+class StateRegistry {
+private:
+	unsigned int numSASVars;
+	unsigned int numNumVars;
+	unsigned int sasWords;				// Words used by the SAS variables
+	unsigned int stateWords;			// Total words per state (numeric values are stored after the SAS variables)
+	std::vector<PackedVariable> vars;
+	std::vector<uint64_t> valueKeys;	// Zobrist keys of the SAS variable values
+	std::vector<uint64_t> numericKeys;	// Zobrist seeds of the numeric variables
+	StateRegistryShard shards[REGISTRY_NUM_SHARDS];
+
+	void addDomainValues(SASAction* a, std::vector<std::vector<TValue> >& domains);
+	void pack(TState* s, uint64_t* dest);
+	void growHashTable(StateRegistryShard& shard);
+
+public:
+	StateRegistry(SASTask* task, std::vector<SASAction*>& fictitiousActions);
+	inline uint64_t getValueKey(unsigned int var, TValue value) {	// Zobrist key of (var = value)
+		PackedVariable& pv = vars[var];
+		unsigned int index = (unsigned int)value - pv.minValue;
+		if (value < pv.minValue || index >= pv.localIndex.size())
+			throwError("Value " + std::to_string(value) + " out of the domain of variable " + std::to_string(var));
+		return valueKeys[pv.keyOffset + index];
+	}
+	static inline TFloatValue quantize(TFloatValue v) {	// Numeric values are compared in thousandths, as the schedules (round3d)
+		if (v > -MAX_QUANTIZED_VALUE && v < MAX_QUANTIZED_VALUE)
+			v = (TFloatValue)(std::round((double)v * 1000) / 1000);
+		return v + 0.0f;	// -0 and +0 are the same value
+	}
+	inline uint64_t getNumericKey(unsigned int var, TFloatValue min, TFloatValue max) {	// Zobrist key of var in [min, max]
+		uint32_t minBits, maxBits;
+		min = quantize(min);
+		max = quantize(max);
+		std::memcpy(&minBits, &min, sizeof(uint32_t));
+		std::memcpy(&maxBits, &max, sizeof(uint32_t));
+		uint64_t k = numericKeys[var] ^ (((uint64_t)maxBits << 32) | minBits);
+		k = (k ^ (k >> 33)) * 0xff51afd7ed558ccdULL;
+		k = (k ^ (k >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+		return k ^ (k >> 33);
+	}
+	uint64_t getHash(TState* s);
+	TStateId insert(TState* s, uint64_t hash);	// Returns the id of the state, registering it if it is new
+	inline TStateId insert(TState* s) { return insert(s, getHash(s)); }
+	void unpack(TStateId id, TState* s);
+	TStateId size();
+};
+
+#endif
@@ -19,77 +19,36 @@ using namespace std;
 // Computes the order relationships among time points
 void Successors::computeOrderMatrix()
 {
-	if (currentIteration == MAX_UNSIGNED_INT) {	// Reset matrix (maximum number of iterations reached)
+	if (currentIteration == MAX_UNSIGNED_INT)	// Maximum number of iterations reached
 		currentIteration = 1;
-		for (unsigned int i = 0; i < matrix.size(); i++)
-			for (unsigned int j = 0; j < matrix[i].size(); j++)
-				matrix[i][j] = 0;
-	}
-	newStep = planComponents.size();								// Steps start by 0
-	TTimePoint lastPoint = stepToEndPoint(newStep);
-	if (lastPoint >= matrix.size()) resizeMatrix();
-	for (unsigned int i = 0; i < planComponents.size(); i++) {
-		if (planComponents.get(i)->action != nullptr) {
-			matrix[stepToStartPoint(i)][stepToEndPoint(i)] = currentIteration;		// Start point of the step always before the end point of the step 
-		}
-	}
-	matrix[lastPoint - 1][lastPoint] = currentIteration;					// The same for the new step to be added
-	for (unsigned int i = 0; i < planComponents.size(); i++) {
-		Plan& p = *(planComponents.get(i));
-		for (unsigned int j = 0; j < p.orderings.size(); j++) {				// Plan orderings
-			matrix[firstPoint(p.orderings[j])][secondPoint(p.orderings[j])] = currentIteration;
-		}
-		if (i > 0) {
-			matrix[1][i << 1] = currentIteration;							// Orderings with the initial step
-			matrix[1][(i << 1) + 1] = currentIteration;
-		}
-	}
-}
-
-// Makes the order matrix larger
-void Successors::resizeMatrix()
-{
-	unsigned int newSize = (unsigned int)matrix.size() + MATRIX_INCREASE;
-	matrix.resize(newSize);
-	for (unsigned int i = 0; i < newSize; i++)
-		matrix[i].resize(newSize, 0);
+	newStep = planComponents.size();			// Steps start by 0
+	matrix.update(planComponents);				// Only the steps not shared with the previous base plan are recomputed
+	network.update(planComponents);
 }
 
 // Fill the planEffects matrix with the effects produced by the base plan
 void Successors::computeBasePlanEffects(std::vector<TTimePoint>& linearOrder)
 {
 	planEffects.setCurrentIteration(currentIteration, &planComponents);
-	PlanPoint* planPoint;
 	std::vector<SASCondition>* eff;
 	for (int i = 1; i < linearOrder.size(); i++) {
 		TTimePoint timePoint = linearOrder[i];
 		TStep step = timePointToStep(timePoint);
 		Plan* plan = planComponents.get(step);
 		bool atStart = (timePoint & 1) == 0;
-		if (atStart) {
-			planPoint = &(plan->startPoint);
-			eff = &(plan->action->startEff);
-		}
-		else {
-			planPoint = &(plan->endPoint);
-			eff = &(plan->action->endEff);
-		}
+		eff = atStart ? &(plan->action->startEff) : &(plan->action->endEff);
 		for (SASCondition& cond : *eff) {
 			planEffects.addEffect(cond, timePoint);
 		}
-		if (plan->holdCondEff != nullptr) {
-			for (int numCondEff : *plan->holdCondEff) {
-				SASConditionalEffect& ce = plan->action->conditionalEff[numCondEff];
-				eff = atStart ? &ce.startEff : &ce.endEff;
-				for (SASCondition& cond : *eff) {
-					planEffects.addEffect(cond, timePoint);
-				}
+		for (int numCondEff : plan->getConditionalEffects()) {
+			SASConditionalEffect& ce = plan->action->conditionalEff[numCondEff];
+			eff = atStart ? &ce.startEff : &ce.endEff;
+			for (SASCondition& cond : *eff) {
+				planEffects.addEffect(cond, timePoint);
 			}
 		}
-		if (planPoint->numVarValues != nullptr) {
-			for (TFluentInterval& fi : *(planPoint->numVarValues)) {
-				planEffects.addNumEffect(fi, timePoint);
-			}
+		for (TFluentInterval& fi : plan->getNumVarValues(atStart)) {
+			planEffects.addNumEffect(fi, timePoint);
 		}
 	}
 }
@@ -97,10 +56,10 @@ void Successors::computeBasePlanEffects(std::vector<TTimePoint>& linearOrder)
 void Successors::fullSuccessorsCalculation()
 {
 	for (unsigned int i = 0; i < task->goals.size(); i++) {
-		fullActionCheck(&(task->goals[i]), MAX_UINT16, 0, 0, 0);
+		checkAction(&(task->goals[i]), MAX_UINT16, 0, 0, 0);
 	}
 	for (unsigned int i = 0; i < task->actions.size(); i++) {
-		fullActionCheck(&(task->actions[i]), MAX_UINT16, 0, 0, 0);
+		checkAction(&(task->actions[i]), MAX_UINT16, 0, 0, 0);
 	}
 }
 
@@ -120,7 +79,7 @@ void Successors::fullActionCheck(SASAction* a, TVariable var, TValue value, TTim
 			//if (a->isGoal)
 			//	cout << "aqui" << endl;
 			//cout << "Action " << a->name << " supported" << endl;
-			PlanBuilder pb(a, newStep, &matrix, numSupportState, &planEffects, task);
+			PlanBuilder pb(a, newStep, &matrix, &network, numSupportState, &planEffects, task);
 			unsigned int n = 0;
 			if (var != MAX_UINT16) {
 				n = addActionSupport(&pb, var, value, effectTime, startTimeNewAction);
@@ -278,26 +237,32 @@ bool Successors::supportedConditions(const SASAction* a)
 }
 
 Successors::Successors(TState* state, SASTask* task, bool forceAtEndConditions, bool filterRepeatedStates,
-	std::vector<SASAction*>* tilActions) : planEffects(task)
+	std::vector<SASAction*>* tilActions, StateRegistry* stateRegistry) : planEffects(task)
 {
 	this->task = task;
 	this->initialState = state;
+	this->forceAtEndConditions = forceAtEndConditions;
+	this->tilActions = tilActions;
+	this->stateRegistry = stateRegistry;
 	this->filterRepeatedStates = filterRepeatedStates;
 	numVariables = (unsigned int)task->variables.size();
 	numActions = (unsigned int)task->actions.size();
 	idPlan = 0;
 	solution = nullptr;
-	evaluator.initialize(state, task, tilActions, forceAtEndConditions);
+	sharedSearchTree = false;
+	preferredOperators = false;
+	lazyEvaluation = false;
+	threadPool = nullptr;
+	candidates = nullptr;
+	evaluator.initialize(state, task, tilActions, forceAtEndConditions, stateRegistry, &planComponents);
 	successors = nullptr;
 	basePlan = nullptr;
 	newStep = 0;
 	for (unsigned int i = 0; i < numActions; i++) {
 		checkedAction.push_back(0);
 	}
+	helpfulAction.resize(numActions, 0);
 	currentIteration = 0;
-	matrix.resize(INITAL_MATRIX_SIZE);
-	for (unsigned int i = 0; i < INITAL_MATRIX_SIZE; i++)
-		matrix[i].resize(INITAL_MATRIX_SIZE, 0);
 }
 
 void Successors::checkConditionalEffects(PlanBuilder* pb, int numEff) {
@@ -529,18 +494,29 @@ void Successors::generateSuccessor(PlanBuilder* pb)
 
 // Destructor
 Successors::~Successors() {
+	if (threadPool != nullptr) delete threadPool;
+	for (Successors* s : helpers)
+		delete s;
+}
+
+// Sets the number of threads used to check the candidate actions of a base plan
+void Successors::setExpansionThreads(unsigned int numThreads)
+{
+	if (numThreads <= 1 || threadPool != nullptr) return;
+	for (unsigned int i = 1; i < numThreads; i++)
+		helpers.push_back(new Successors(initialState, task, forceAtEndConditions, filterRepeatedStates, tilActions,
+			stateRegistry));
+	threadPool = new ThreadPool(numThreads);
 }
 
+// Adds a new successor plan. It is evaluated later, together with its brothers, in evaluateSuccessors
 void Successors::addSuccessor(Plan* p)
 {
 	if (PrintPlan::getMakespan(p) > bestMakespan) {
 		delete p;
 	}
 	else {
-		evaluator.calculateFrontierState(p);
-		evaluator.evaluate(p);
-		
-		//cout << "* Successor: " << idPlan << ", " << p->action->name << "(G=" << p->g << ", H=" << p->h << ")" << endl;
+		//cout << "* Successor: " << idPlan << ", " << p->action->name << endl;
 		//cout << "Plan " << p->id << " (" << p->action->name << ") generated" << endl;
 		if (p->isSolution()) {
 			//cout << "SOLUTION PLAN" << endl;
@@ -552,21 +528,92 @@ void Successors::addSuccessor(Plan* p)
 	}
 }
 
-// Fills vector suc with the possible successor plans of the given base plan
-void Successors::computeSuccessors(Plan* base, std::vector<Plan*>* suc, float bestMakespan)
+// Computes the frontier state and the heuristic value of the new successors. If the thread pool is available,
+// the plans are evaluated in parallel, each thread with its own evaluator
+void Successors::evaluateSuccessors()
+{
+	if (solution != nullptr && solution->stateId == NO_STATE) {
+		evaluator.calculateFrontierState(solution);
+		evaluator.evaluate(solution);
+	}
+	std::vector<Plan*>& plans = *successors;
+	if (lazyEvaluation) {
+		if (!plans.empty()) deferSuccessorsEvaluation();
+		return;
+	}
+	if (threadPool == nullptr || plans.size() < 2) {
+		for (Plan* p : plans) {
+			evaluator.calculateFrontierState(p);
+			evaluator.evaluate(p);
+		}
+	}
+	else {
+		std::atomic<unsigned int> nextPlan(0);
+		threadPool->run([&](unsigned int worker) {
+			Evaluator& e = worker == 0 ? evaluator : helpers[worker - 1]->evaluator;
+			unsigned int i;
+			while ((i = nextPlan.fetch_add(1, std::memory_order_relaxed)) < plans.size()) {
+				e.calculateFrontierState(plans[i]);
+				e.evaluate(plans[i]);
+			}
+		});
+	}
+}
+
+// Marks as preferred the successors that add an action of the relaxed plan of the base plan
+void Successors::markPreferredSuccessors()
+{
+	for (SASAction* a : *evaluator.computeRelaxedPlan(basePlan)) {
+		if (!a->isGoal && !a->isTIL && a->index < numActions)
+			helpfulAction[a->index] = currentIteration;
+	}
+	for (Plan* p : *successors) {
+		p->preferred = helpfulAction[p->action->index] == currentIteration;
+	}
+}
+
+// Lazy evaluation: the successors inherit the heuristic values of the base plan. The ones that add an action of
+// the relaxed plan of the base plan (already computed when it was evaluated) are expected to be one step closer.
+// If the search tree is shared, the frontier states are calculated anyway, as they select the thread that
+// expands each plan
+void Successors::deferSuccessorsEvaluation()
+{
+	markPreferredSuccessors();
+	for (Plan* p : *successors) {
+		p->h = p->preferred && basePlan->h > 0 ? basePlan->h - 1 : basePlan->h;
+		p->hLand = basePlan->hLand;
+		if (sharedSearchTree) {
+			evaluator.calculateFrontierState(p);
+			p->pendingEvaluation = true;
+		}
+	}
+}
+
+// Computes the orderings and effects of the base plan
+void Successors::prepareBasePlan(Plan* base)
 {
 	this->basePlan = base;
-	this->bestMakespan = bestMakespan;
 	currentIteration++;
 	planComponents.calculate(base);
 	computeOrderMatrix();
 	linearizer.linearize(planComponents);
 	computeBasePlanEffects(linearizer.linearOrder);
+}
+
+// Fills vector suc with the possible successor plans of the given base plan
+void Successors::computeSuccessors(Plan* base, std::vector<Plan*>* suc, float bestMakespan)
+{
+	this->bestMakespan = bestMakespan;
+	prepareBasePlan(base);
 	successors = suc;
 	suc->clear();
 	for (SASAction& a : task->goals) {
 		fullActionCheck(&a, MAX_UINT16, 0, 0, 0);
 	}
+	if (threadPool != nullptr) {
+		candidateList.clear();
+		candidates = &candidateList;
+	}
 	if (base->isRoot() || base->action->endEff.empty()) {			// Full calculation of successors
 		fullSuccessorsCalculation();
 	}
@@ -574,26 +621,82 @@ void Successors::computeSuccessors(Plan* base, std::vector<Plan*>* suc, float be
 		computeSuccessorsSupportedByLastActions();
 		computeSuccessorsThroughBrotherPlans();
 	}
+	if (candidates != nullptr) {
+		candidates = nullptr;
+		checkCandidates();
+	}
+	evaluateSuccessors();
+	if (preferredOperators && !lazyEvaluation && !successors->empty())
+		markPreferredSuccessors();
 }
 
-bool Successors::repeatedState(Plan* p)
+// Checks the action or stores it as a candidate if the parallel expansion is used
+void Successors::checkAction(SASAction* a, TVariable var, TValue value, TTimePoint effectTime, TTimePoint startTimeNewAction)
 {
-	if (!filterRepeatedStates) return false;
-	uint64_t code = p->fs->getCode();
-	std::unordered_map<uint64_t, std::vector<Plan*> >::const_iterator got = memo.find(code);
-	if (got != memo.end()) {
-		for (Plan* op : got->second) {
-			if (p->fs->compareTo(op->fs)) {
-				return true;	// Repeated state
-			}
-		}
-		memo[code].push_back(p);
+	if (candidates != nullptr) candidates->emplace_back(a, var, value, effectTime, startTimeNewAction);
+	else fullActionCheck(a, var, value, effectTime, startTimeNewAction);
+}
+
+// Checks the stored candidates
+void Successors::checkCandidates()
+{
+	if (candidateList.size() < MIN_PARALLEL_CANDIDATES) {
+		for (SuccessorCandidate& c : candidateList)
+			fullActionCheck(c.action, c.var, c.value, c.effectTime, c.startTimeNewAction);
 	}
 	else {
-		std::vector<Plan*> v;
-		v.push_back(p);
-		memo[code] = v;
+		for (SuccessorCandidate& c : candidateList) {	// Goals are checked first, as they can set the solution plan
+			if (c.action->isGoal)
+				fullActionCheck(c.action, c.var, c.value, c.effectTime, c.startTimeNewAction);
+		}
+		parallelCandidatesCheck();
 	}
+}
+
+// Checks the non-goal candidates in parallel. Each thread has its own order matrix, plan effects and evaluator.
+// The successors are merged in the order of the candidates, so the result is the same as in the sequential expansion
+void Successors::parallelCandidatesCheck()
+{
+	unsigned int numCandidates = (unsigned int)candidateList.size();
+	candidateSuccessors.resize(numCandidates);
+	for (unsigned int i = 0; i < numCandidates; i++)
+		candidateSuccessors[i].clear();
+	std::atomic<unsigned int> nextCandidate(0);
+	std::vector<Plan*>* mergedSuccessors = successors;
+	threadPool->run([&](unsigned int worker) {
+		Successors* s = this;
+		if (worker > 0) {
+			s = helpers[worker - 1];
+			s->solution = solution;
+			s->bestMakespan = bestMakespan;
+			s->prepareBasePlan(basePlan);
+		}
+		unsigned int i;
+		while ((i = nextCandidate.fetch_add(1, std::memory_order_relaxed)) < numCandidates) {
+			SuccessorCandidate& c = candidateList[i];
+			if (!c.action->isGoal) {
+				s->successors = &candidateSuccessors[i];
+				s->fullActionCheck(c.action, c.var, c.value, c.effectTime, c.startTimeNewAction);
+			}
+		}
+	});
+	successors = mergedSuccessors;
+	for (std::vector<Plan*>& v : candidateSuccessors) {
+		for (Plan* p : v) {
+			p->id = ++idPlan;
+			successors->push_back(p);
+		}
+	}
+}
+
+bool Successors::repeatedState(Plan* p)
+{
+	if (!filterRepeatedStates) return false;
+	if (p->stateId >= visitedStates.size())
+		visitedStates.resize(p->stateId + 1 > 2 * visitedStates.size() ? p->stateId + 1 : 2 * visitedStates.size(), false);
+	if (visitedStates[p->stateId])
+		return true;	// Repeated state
+	visitedStates[p->stateId] = true;
 	return false;
 }
 
@@ -610,7 +713,7 @@ void Successors::computeSuccessorsSupportedByLastActions()
 			if (!visitedAction(ra)) {
 				setVisitedAction(ra);
 				//cout << "Action " << ra->name << " supported by at-start" << endl;
-				fullActionCheck(ra, c.var, c.value, startTimeLastAction, startTimeNewAction);
+				checkAction(ra, c.var, c.value, startTimeLastAction, startTimeNewAction);
 			}
 		}
 	}
@@ -620,7 +723,7 @@ void Successors::computeSuccessorsSupportedByLastActions()
 			if (!visitedAction(ra)) {
 				setVisitedAction(ra);
 				//cout << "Action " << ra->name << " supported by at-end" << endl;
-				fullActionCheck(ra, c.var, c.value, startTimeLastAction + 1, startTimeNewAction);
+				checkAction(ra, c.var, c.value, startTimeLastAction + 1, startTimeNewAction);
 			}
 		}
 	}
@@ -629,7 +732,7 @@ void Successors::computeSuccessorsSupportedByLastActions()
 		for (SASAction* ra : req) {
 			if (!visitedAction(ra)) {
 				setVisitedAction(ra);
-				fullActionCheck(ra, MAX_UINT16, 0, startTimeLastAction, startTimeNewAction);
+				checkAction(ra, MAX_UINT16, 0, startTimeLastAction, startTimeNewAction);
 			}
 		}
 	}
@@ -638,7 +741,7 @@ void Successors::computeSuccessorsSupportedByLastActions()
 		for (SASAction* ra : req) {
 			if (!visitedAction(ra)) {
 				setVisitedAction(ra);
-				fullActionCheck(ra, MAX_UINT16, 0, startTimeLastAction + 1, startTimeNewAction);
+				checkAction(ra, MAX_UINT16, 0, startTimeLastAction + 1, startTimeNewAction);
 			}
 		}
 	}
@@ -684,12 +787,12 @@ unsigned int Successors::addActionSupport(PlanBuilder* pb, TVariable var, TValue
 void Successors::computeSuccessorsThroughBrotherPlans()
 {
 	Plan* parentPlan = basePlan->parentPlan;
-	vector<Plan*>* brotherPlans = parentPlan->childPlans;
+	ArenaVector<Plan*>* brotherPlans = parentPlan->childPlans;
 	for (unsigned int i = 0; i < brotherPlans->size(); i++) {
 		Plan* brotherPlan = (*brotherPlans)[i];
-		if (brotherPlan != basePlan && !brotherPlan->expanded() && !visitedAction(brotherPlan->action)) {
+		if (brotherPlan != basePlan && (sharedSearchTree || !brotherPlan->expanded()) && !visitedAction(brotherPlan->action)) {
 			setVisitedAction(brotherPlan->action);
-			fullActionCheck(brotherPlan->action, MAX_UINT16, 0, 0, 0);
+			checkAction(brotherPlan->action, MAX_UINT16, 0, 0, 0);
 		}
 	}
 }
@@ -754,17 +857,17 @@ void Successors::checkThreatsBetweenCausalLinksInBasePlanAndNewActionEffects(Pla
 	TTimePoint p2 = 0;
 	for (TStep i = 0; i < planComponents.size(); i++) {
 		Plan* planComp = planComponents.get(i);
-		for (TCausalLink& cl : planComp->startPoint.causalLinks) {
+		for (TCausalLink& cl : planComp->getCausalLinks(true)) {
 			checkThreatBetweenCausalLinkInBasePlanAndNewActionEffects(pb, threats, cl, p2);
 		}
-		for (TNumericCausalLink& cl : planComp->startPoint.numCausalLinks) {
+		for (TNumericCausalLink& cl : planComp->getNumericCausalLinks(true)) {
 			checkThreatBetweenCausalLinkInBasePlanAndNewActionEffects(pb, threats, cl, p2);
 		}
 		p2++;
-		for (TCausalLink& cl : planComp->endPoint.causalLinks) {
+		for (TCausalLink& cl : planComp->getCausalLinks(false)) {
 			checkThreatBetweenCausalLinkInBasePlanAndNewActionEffects(pb, threats, cl, p2);
 		}
-		for (TNumericCausalLink& cl : planComp->endPoint.numCausalLinks) {
+		for (TNumericCausalLink& cl : planComp->getNumericCausalLinks(false)) {
 			checkThreatBetweenCausalLinkInBasePlanAndNewActionEffects(pb, threats, cl, p2);
 		}
 		p2++;
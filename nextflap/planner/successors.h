@@ -8,17 +8,21 @@
 /* Calculation of succesors of a given plan             */
 /********************************************************/
 
+#include <atomic>
 #include "../sas/sasTask.h"
 #include "state.h"
+#include "stateRegistry.h"
 #include "plan.h"
 #include "planEffects.h"
 #include "planBuilder.h"
 #include "planComponents.h"
+#include "orderMatrix.h"
+#include "temporalNetwork.h"
 #include "linearizer.h"
 #include "../heuristics/evaluator.h"
+#include "../utils/threadPool.h"
 
-#define INITAL_MATRIX_SIZE	400
-#define MATRIX_INCREASE		200
+#define MIN_PARALLEL_CANDIDATES	16	// Minimum number of candidate actions to check them in parallel
 
 class Threat {
 public:
@@ -37,10 +41,31 @@ public:
 	}
 };
 
+// Action to check for generating successors, and the condition supported by the last step of the base plan (if any)
+class SuccessorCandidate {
+public:
+	SASAction* action;
+	TVariable var;
+	TValue value;
+	TTimePoint effectTime;
+	TTimePoint startTimeNewAction;
+
+	SuccessorCandidate(SASAction* a, TVariable var, TValue value, TTimePoint effectTime, TTimePoint startTimeNewAction) {
+		action = a;
+		this->var = var;
+		this->value = value;
+		this->effectTime = effectTime;
+		this->startTimeNewAction = startTimeNewAction;
+	}
+};
+
 class Successors {
 private:
 	SASTask* task;
 	TState* initialState;
+	bool forceAtEndConditions;
+	std::vector<SASAction*>* tilActions;
+	StateRegistry* stateRegistry;
 	bool filterRepeatedStates;
 	unsigned int numVariables;							// Number of variables
 	unsigned int numActions;							// Number of grounded actions
@@ -50,14 +75,25 @@ private:
 	Plan* basePlan;										// Base plan
 	TStep newStep;										// New step to add as successor
 	std::vector<unsigned int> checkedAction;
+	std::vector<unsigned int> helpfulAction;			// Actions in the relaxed plan of the base plan (== currentIteration)
 	unsigned int currentIteration;
 	PlanComponents planComponents;						// The base plan is made up by incremental components, which are stored in this vector
-	std::vector< std::vector<unsigned int> > matrix;	// Orders between time points in the current plan
+														// (shared with the evaluator and the plan validator of this thread)
+	OrderMatrix matrix;									// Orders between time points in the current plan
+	TemporalNetwork network;							// Earliest and latest times of the time points in the current plan
 	Linearizer linearizer;
 	float bestMakespan;
+	ThreadPool* threadPool;								// Threads for the parallel expansion (nullptr if not used)
+	std::vector<Successors*> helpers;					// Successors calculators and evaluators of the pool threads (except the first one)
+	std::vector<SuccessorCandidate>* candidates;		// If not nullptr, actions are stored here instead of being checked
+	std::vector<SuccessorCandidate> candidateList;
+	std::vector< std::vector<Plan*> > candidateSuccessors;	// Successors generated by each candidate in the parallel expansion
 
+	void prepareBasePlan(Plan* base);
+	void checkAction(SASAction* a, TVariable var, TValue value, TTimePoint effectTime, TTimePoint startTimeNewAction);
+	void checkCandidates();
+	void parallelCandidatesCheck();
 	void computeOrderMatrix();
-	void resizeMatrix();
 	void computeBasePlanEffects(std::vector<TTimePoint>& linearOrder);
 	void fullSuccessorsCalculation();
 	void fullActionCheck(SASAction* a, TVariable var, TValue value, TTimePoint effectTime, TTimePoint startTimeNewAction);
@@ -78,7 +114,7 @@ private:
 		TCausalLink& cl, TTimePoint p2);
 	void checkThreatBetweenCausalLinkInBasePlanAndNewActionEffects(PlanBuilder* pb, std::vector<Threat>* threats,
 		TNumericCausalLink& cl, TTimePoint p2);
-	inline bool existOrder(TTimePoint t1, TTimePoint t2) { return matrix[t1][t2] == currentIteration; }
+	inline bool existOrder(TTimePoint t1, TTimePoint t2) { return matrix.existOrder(t1, t2); }
 	void checkThreatsBetweenNewCausalLinksAndActionsInBasePlan(PlanBuilder* pb, std::vector<Threat>* threats);
 	void solveThreats(PlanBuilder* pb, std::vector<Threat>* threats);
 	void checkContradictoryEffects(PlanBuilder* pb);
@@ -88,6 +124,9 @@ private:
 	SASCondition* getRequiredValue(TTimePoint p, SASAction* a, TVariable var);
 	SASCondition* getRequiredValue(SASAction* a, TVariable var);
 	void addSuccessor(Plan* p);
+	void evaluateSuccessors();
+	void markPreferredSuccessors();
+	void deferSuccessorsEvaluation();
 	void computeSuccessorsSupportedByLastActions();
 	inline bool visitedAction(SASAction* a) { return checkedAction[a->index] == currentIteration; }
 	inline void setVisitedAction(SASAction* a) { checkedAction[a->index] = currentIteration; }
@@ -104,14 +143,19 @@ private:
 
 public:
 	Evaluator evaluator;
-	std::unordered_map<uint64_t, std::vector<Plan*> > memo;
+	std::vector<bool> visitedStates;		// Indexed by state id
 	Plan* solution;
+	bool sharedSearchTree;		// The plans are expanded by several threads, so the brother plans can be being expanded
+	bool preferredOperators;	// Mark the successors whose action is in the relaxed plan of the base plan
+	bool lazyEvaluation;		// The successors are evaluated when they are selected for expansion
 	
 	Successors(TState* state, SASTask* task, bool forceAtEndConditions, bool filterRepeatedStates,
-		std::vector<SASAction*>* tilActions);
+		std::vector<SASAction*>* tilActions, StateRegistry* stateRegistry);
 	~Successors();
+	void setExpansionThreads(unsigned int numThreads);
 	void computeSuccessors(Plan* base, std::vector<Plan*>* suc, float bestMakespan);
 	bool repeatedState(Plan* p);
+	inline PlanComponents* getPlanComponents() { return &planComponents; }
 };
 
 #endif // !SUCCESSORS_H
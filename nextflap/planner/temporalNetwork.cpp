@@ -0,0 +1,169 @@
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Simple temporal network of a plan.                   */
+/********************************************************/
+
+#include "temporalNetwork.h"
+using namespace std;
+
+#define TN_TOLERANCE	(EPSILON / 2)	// Rounding errors allowed when the bounds are compared
+
+/********************************************************/
+/* CLASS: TemporalNetwork                               */
+/********************************************************/
+
+// Removes the bounds and orderings of the components after the first numLevels ones
+void TemporalNetwork::undo(unsigned int numLevels)
+{
+	unsigned int logSize = numLevels == 0 ? 0 : levelEnd[numLevels - 1];
+	while (log.size() > logSize) {
+		TNBoundUpdate& u = log.back();
+		if (u.latest) latest[u.timePoint] = u.time;
+		else earliest[u.timePoint] = u.time;
+		log.pop_back();
+	}
+	unsigned int numEdges = numLevels == 0 ? 0 : edgesEnd[numLevels - 1];
+	while (edges.size() > numEdges) {		// Edges are removed in reverse order, so they are always the last ones
+		TOrdering o = edges.back();
+		next[firstPoint(o)].pop_back();
+		prev[secondPoint(o)].pop_back();
+		edges.pop_back();
+	}
+	levels.resize(numLevels);
+	levelIds.resize(numLevels);
+	levelEnd.resize(numLevels);
+	edgesEnd.resize(numLevels);
+}
+
+// Adds an ordering between two time points
+void TemporalNetwork::addEdge(TTimePoint t1, TTimePoint t2)
+{
+	next[t1].push_back(t2);
+	prev[t2].push_back(t1);
+	edges.push_back(getOrdering(t1, t2));
+}
+
+// Adds the time points and orderings of a plan component, and updates the bounds of the points affected by them
+void TemporalNetwork::apply(Plan* p, TStep step)
+{
+	TTimePoint start = stepToStartPoint(step), end = stepToEndPoint(step);
+	if (end >= earliest.size()) {
+		earliest.resize(end + 1);
+		latest.resize(end + 1);
+		next.resize(end + 1);
+		prev.resize(end + 1);
+	}
+	if (step >= minDuration.size()) minDuration.resize(step + 1);
+	if (p->fixedInit) {											// Initial and TIL steps
+		earliest[start] = latest[start] = p->startPoint.getInitialTime();
+		earliest[end] = latest[end] = p->endPoint.getInitialTime();
+		minDuration[step] = earliest[end] - earliest[start];
+	}
+	else {
+		minDuration[step] = max(0.0f, p->actionDuration.minValue - EPSILON);	// Z3 rounds the durations
+		earliest[start] = EPSILON;
+		earliest[end] = EPSILON + minDuration[step];
+		latest[start] = latest[end] = FLOAT_INFINITY;
+	}
+	addEdge(start, end);
+	for (TOrdering o : p->getOrderings()) {
+		TTimePoint t1 = firstPoint(o), t2 = secondPoint(o);
+		if (t1 != start || t2 != end) addEdge(t1, t2);
+	}
+	if (!p->fixedInit) {
+		for (TTimePoint t : prev[start]) earliest[start] = max(earliest[start], earliest[t] + distance(t, start));
+		for (TTimePoint t : prev[end]) earliest[end] = max(earliest[end], earliest[t] + distance(t, end));
+		for (TTimePoint t : next[end]) latest[end] = min(latest[end], latest[t] - distance(end, t));
+		for (TTimePoint t : next[start]) latest[start] = min(latest[start], latest[t] - distance(start, t));
+	}
+	// All the orderings added involve the new points, or are implied by other orderings through them,
+	// so only the bounds of the points ordered with the new step can change
+	pending.clear();
+	pending.push_back(start);
+	pending.push_back(end);
+	propagate();
+	levels.push_back(p);
+	levelIds.push_back(p->id);
+	levelEnd.push_back((unsigned int)log.size());
+	edgesEnd.push_back((unsigned int)edges.size());
+}
+
+// Propagates the bounds of the pending time points through the orderings. As the orderings
+// have no cycles, it ends when the affected cone of points has been updated
+void TemporalNetwork::propagate()
+{
+	while (!pending.empty()) {
+		TTimePoint t = pending.back();
+		pending.pop_back();
+		for (TTimePoint n : next[t]) {
+			TFloatValue time = earliest[t] + distance(t, n);
+			if (time > earliest[n]) setEarliest(n, time);
+		}
+		for (TTimePoint p : prev[t]) {
+			TFloatValue time = latest[t] - distance(p, t);
+			if (time < latest[p]) setLatest(p, time);
+		}
+	}
+}
+
+// Computes the bounds of the given plan. Only the components that differ from the previously
+// computed plan are applied
+void TemporalNetwork::update(PlanComponents& planComponents)
+{
+	TStep numSteps = planComponents.size();
+	unsigned int common = 0;
+	while (common < levels.size() && common < numSteps && levels[common] == planComponents.get(common) &&
+		levelIds[common] == planComponents.get(common)->id)
+		common++;
+	undo(common);
+	for (TStep i = common; i < numSteps; i++)
+		apply(planComponents.get(i), i);
+}
+
+// Checks if an ordering between two time points of the base plan makes the plan temporally
+// inconsistent, i.e. t1 cannot be scheduled before the latest time of t2 (for example, when
+// t2 is a TIL or it must happen before a TIL)
+bool TemporalNetwork::invalidOrdering(TTimePoint t1, TTimePoint t2)
+{
+	return earliest[t1] + EPSILON > latest[t2] + TN_TOLERANCE;
+}
+
+// Checks if a new step can be scheduled, given its minimum duration and the orderings with the
+// points of the base plan. Only the bounds of the new time points are computed, so the check
+// takes time linear in the number of orderings added by the new step
+bool TemporalNetwork::consistentStep(TTimePoint startPoint, TFloatValue duration, std::vector<TOrdering>& orderings,
+	OrderMatrix* matrix)
+{
+	TTimePoint endPoint = startPoint + 1;
+	TFloatValue dur = max(0.0f, duration - EPSILON);
+	TFloatValue earliestStart = EPSILON, earliestEnd, latestStart, latestEnd = FLOAT_INFINITY;
+	for (TOrdering o : orderings) {								// [] -----> [ New step ]
+		if (secondPoint(o) == startPoint && firstPoint(o) < startPoint)
+			earliestStart = max(earliestStart, earliest[firstPoint(o)] + EPSILON);
+	}
+	earliestEnd = earliestStart + dur;
+	for (TOrdering o : orderings) {								// [] ------ [ New step -->]
+		TTimePoint t = firstPoint(o);
+		if (secondPoint(o) == endPoint && t < startPoint) {		// The point can also be after the start of the new step
+			TFloatValue time = earliest[t];
+			if (matrix->existOrder(startPoint, t)) time = max(time, earliestStart + EPSILON);
+			earliestEnd = max(earliestEnd, time + EPSILON);
+		}
+	}
+	for (TOrdering o : orderings) {								// [ New step ] -----> []
+		if (firstPoint(o) == endPoint && secondPoint(o) < startPoint)
+			latestEnd = min(latestEnd, latest[secondPoint(o)] - EPSILON);
+	}
+	latestStart = latestEnd - dur;
+	for (TOrdering o : orderings) {								// [<-- New step ] ------ []
+		TTimePoint t = secondPoint(o);
+		if (firstPoint(o) == startPoint && t < startPoint) {	// The point can also be before the end of the new step
+			TFloatValue time = latest[t];
+			if (matrix->existOrder(t, endPoint)) time = min(time, latestEnd - EPSILON);
+			latestStart = min(latestStart, time - EPSILON);
+		}
+	}
+	return earliestStart <= latestStart + TN_TOLERANCE && earliestEnd <= latestEnd + TN_TOLERANCE;
+}
@@ -0,0 +1,75 @@
+#ifndef TEMPORAL_NETWORK_H
+#define TEMPORAL_NETWORK_H
+
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Simple temporal network of a plan. For each time     */
+/* point, it keeps the earliest and the latest time at  */
+/* which it can be scheduled, according to the plan     */
+/* orderings, the minimum durations of the actions and  */
+/* the fixed times of the initial and the TIL steps.    */
+/* As the order matrix, it is updated incrementally:    */
+/* the bounds changed by each plan component are        */
+/* logged, so only the affected time points are undone  */
+/* and recomputed when the base plan changes.           */
+/********************************************************/
+
+#include "../utils/utils.h"
+#include "plan.h"
+#include "planComponents.h"
+#include "orderMatrix.h"
+
+// Previous value of a time bound
+class TNBoundUpdate {
+public:
+	TTimePoint timePoint;
+	bool latest;				// Latest time (true) or earliest time (false)
+	TFloatValue time;
+	TNBoundUpdate(TTimePoint tp, bool l, TFloatValue t) { timePoint = tp; latest = l; time = t; }
+};
+
+class TemporalNetwork {
+private:
+	std::vector<TFloatValue> earliest;				// Earliest time of each time point
+	std::vector<TFloatValue> latest;				// Latest time of each time point
+	std::vector<TFloatValue> minDuration;			// Minimum duration of each step
+	std::vector<std::vector<TTimePoint>> next;		// Time points ordered after each time point
+	std::vector<std::vector<TTimePoint>> prev;		// Time points ordered before each time point
+	std::vector<Plan*> levels;						// Plan components currently applied to the network
+	std::vector<TPlanId> levelIds;					// Ids of those components (to detect reused memory)
+	std::vector<unsigned int> levelEnd;				// Size of the log after applying each component
+	std::vector<unsigned int> edgesEnd;				// Size of the edges vector after applying each component
+	std::vector<TNBoundUpdate> log;					// Previous bounds changed by each component, in order
+	std::vector<TOrdering> edges;					// Orderings added by each component, in order
+	std::vector<TTimePoint> pending;				// For internal calculations
+
+	void undo(unsigned int numLevels);
+	void apply(Plan* p, TStep step);
+	void addEdge(TTimePoint t1, TTimePoint t2);
+	void propagate();
+	inline TFloatValue distance(TTimePoint t1, TTimePoint t2) {		// Minimum distance between two ordered points
+		return (t1 & 1) == 0 && t2 == t1 + 1 ? minDuration[timePointToStep(t1)] : EPSILON;
+	}
+	inline void setEarliest(TTimePoint t, TFloatValue time) {
+		log.emplace_back(t, false, earliest[t]);
+		earliest[t] = time;
+		pending.push_back(t);
+	}
+	inline void setLatest(TTimePoint t, TFloatValue time) {
+		log.emplace_back(t, true, latest[t]);
+		latest[t] = time;
+		pending.push_back(t);
+	}
+
+public:
+	void update(PlanComponents& planComponents);
+	bool invalidOrdering(TTimePoint t1, TTimePoint t2);
+	bool consistentStep(TTimePoint startPoint, TFloatValue duration, std::vector<TOrdering>& orderings,
+		OrderMatrix* matrix);
+	inline TFloatValue getEarliestTime(TTimePoint t) { return earliest[t]; }
+	inline TFloatValue getLatestTime(TTimePoint t) { return latest[t]; }
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "z3Checker.h"
+#include <mutex>
 
 /********************************************************/
 /* Oscar Sapena Vercher - DSIC - UPV                    */
@@ -7,55 +8,124 @@
 /* Plan validity checking through Z3 solver.            */
 /********************************************************/
 
+// Z3 global parameters are shared by all the search threads, so they are set only once. Each thread
+// has its own checker and context, so the checks run in parallel
+static std::once_flag z3ParamsSet;
+
+Z3Checker::Z3Checker(PlanComponents* planComponents)
+{
+    this->planComponents = planComponents != nullptr ? planComponents : &localComponents;
+    optimizeMakespan = false;
+    cont = nullptr;
+    checker = nullptr;
+    optimizer = nullptr;
+}
+
+Z3Checker::~Z3Checker()
+{
+    reset();
+}
+
+// Removes all the variables and constraints, and releases the solver
+void Z3Checker::reset()
+{
+    stepVars.clear();       // Expressions must be released before their context
+    levels.clear();
+    levelIds.clear();
+    if (checker != nullptr) delete checker;
+    if (optimizer != nullptr) delete optimizer;
+    if (cont != nullptr) delete cont;
+    checker = nullptr;
+    optimizer = nullptr;
+    cont = nullptr;
+}
+
 bool Z3Checker::checkPlan(Plan* p, bool optimizeMakespan, TControVarValues* cvarValues)
 {
-    z3::set_param("parallel.enable", true);
-    z3::set_param("pp.decimal", true);
-    //z3::set_param("pp.decimal-precision", 3);
+    std::call_once(z3ParamsSet, []() {
+        z3::set_param("parallel.enable", true);
+        z3::set_param("pp.decimal", true);
+        //z3::set_param("pp.decimal-precision", 3);
+    });
     //std::cout << (optimizeMakespan ? "o" : ".");
-    this->optimizeMakespan = optimizeMakespan;
     bool valid = false;
-    planComponents.calculate(p);
-    //for (int i = 0; i < planComponents.size(); i++)
-    //    std::cout << i << ": " << planComponents.get(i)->action->name << std::endl;
+    planComponents->calculate(p);
+    //for (int i = 0; i < planComponents->size(); i++)
+    //    std::cout << i << ": " << planComponents->get(i)->action->name << std::endl;
+    if (!optimizeMakespan) {
+        ValidationResult res = validator.checkPlan(p, planComponents);
+        if (res != VR_UNKNOWN) return res == VR_VALID;
+    }
     try {
-        context c;
-        this->cont = &c;
-        for (TStep s = 0; s < planComponents.size(); s++) {
-            defineVariables(planComponents.get(s), s);
-        }
-        if (optimizeMakespan) 
-            optimizer = new optimize(c);
-        else checker = new solver(c);
-        for (TStep s = 0; s < planComponents.size(); s++) {
-            defineConstraints(planComponents.get(s), s);
-        }
-        TStep lastStep = planComponents.size() - 1;
-        if (optimizeMakespan) {
-            optimizer->minimize(getPointVar(stepToEndPoint(lastStep)));
-            valid = optimizer->check() == sat;
-            //showModel(optimizer->get_model());
-            if (valid) 
-                updatePlan(p, optimizer->get_model(), cvarValues);
-        }
-        else {
-            valid = checker->check() == sat;
-            //if (p->action->isGoal) std::cout << checker->assertions() << std::endl;
-            if (valid) 
-                updatePlan(p, checker->get_model(), cvarValues);
-        }
-        if (optimizeMakespan) delete optimizer;
-        else delete checker;
-        stepVars.clear();
-        Z3_finalize_memory();
+        if (optimizeMakespan) valid = optimizePlan(p, cvarValues);
+        else valid = incrementalCheck(p, cvarValues);
     }
     catch (std::exception& ex) {
+        reset();
         throwError("unexpected error: " + std::string(ex.what()));
     }
     //std::cout << (valid ? "v" : "x") << std::endl;
     return valid;
 }
 
+// Checks the plan reusing the constraints of the steps shared with the previously checked plan
+bool Z3Checker::incrementalCheck(Plan* p, TControVarValues* cvarValues)
+{
+    if (this->optimizeMakespan) reset();
+    this->optimizeMakespan = false;
+    if (cont == nullptr) {
+        cont = new context();
+        checker = new solver(*cont);
+    }
+    TStep numSteps = planComponents->size();
+    unsigned int common = 0;
+    while (common < levels.size() && common < numSteps && levels[common] == planComponents->get(common) &&
+        levelIds[common] == planComponents->get(common)->id)
+        common++;
+    if (levels.size() > common) {
+        checker->pop((unsigned int)levels.size() - common);
+        stepVars.erase(stepVars.begin() + common, stepVars.end());
+        levels.resize(common);
+        levelIds.resize(common);
+    }
+    for (TStep s = common; s < numSteps; s++) {     // The constraints of a step only refer to itself and to previous steps
+        Plan* pc = planComponents->get(s);
+        checker->push();
+        defineVariables(pc, s);
+        defineConstraints(pc, s);
+        levels.push_back(pc);
+        levelIds.push_back(pc->id);
+    }
+    bool valid = checker->check() == sat;
+    //if (p->action->isGoal) std::cout << checker->assertions() << std::endl;
+    if (valid)
+        updatePlan(p, checker->get_model(), cvarValues);
+    return valid;
+}
+
+// Checks the plan minimizing its makespan. The optimizer is not kept, as it is only used for the final plans
+bool Z3Checker::optimizePlan(Plan* p, TControVarValues* cvarValues)
+{
+    reset();
+    this->optimizeMakespan = true;
+    cont = new context();
+    for (TStep s = 0; s < planComponents->size(); s++) {
+        defineVariables(planComponents->get(s), s);
+    }
+    optimizer = new optimize(*cont);
+    for (TStep s = 0; s < planComponents->size(); s++) {
+        defineConstraints(planComponents->get(s), s);
+    }
+    TStep lastStep = planComponents->size() - 1;
+    optimizer->minimize(getPointVar(stepToEndPoint(lastStep)));
+    bool valid = optimizer->check() == sat;
+    //showModel(optimizer->get_model());
+    if (valid)
+        updatePlan(p, optimizer->get_model(), cvarValues);
+    reset();
+    return valid;
+}
+
 void Z3Checker::defineVariables(Plan* p, TStep s)
 {
     char varName[10];
@@ -68,25 +138,19 @@ void Z3Checker::defineVariables(Plan* p, TStep s)
     vars.times.push_back(cont->int_const(varName));       // Start time
     sprintf(varName, "t%d", stepToEndPoint(s));
     vars.times.push_back(cont->int_const(varName));       // End time
-    if (p->cvarValues != nullptr) {
-        for (int cv = 0; cv < p->cvarValues->size(); cv++) {
-            sprintf(varName, "c%ds%d", cv, s);    // Control var
-            vars.controlVars.push_back(cont->real_const(varName));
-        }
+    for (unsigned int cv = 0; cv < p->getControlVarValues().size(); cv++) {
+        sprintf(varName, "c%ds%d", cv, s);    // Control var
+        vars.controlVars.push_back(cont->real_const(varName));
     }
-    if (p->startPoint.numVarValues != nullptr) {
-        for (TFluentInterval& i : *(p->startPoint.numVarValues)) {
-            sprintf(varName, "f%dt%d", i.numVar, stepToStartPoint(s));    // Fluent
-            vars.startFluentIndex[i.numVar] = (int)vars.fluents.size();
-            vars.fluents.push_back(cont->real_const(varName));
-        }
+    for (TFluentInterval& i : p->getNumVarValues(true)) {
+        sprintf(varName, "f%dt%d", i.numVar, stepToStartPoint(s));    // Fluent
+        vars.startFluentIndex[i.numVar] = (int)vars.fluents.size();
+        vars.fluents.push_back(cont->real_const(varName));
     }
-    if (p->endPoint.numVarValues != nullptr) {
-        for (TFluentInterval& i : *(p->endPoint.numVarValues)) {
-            sprintf(varName, "f%dt%d", i.numVar, stepToEndPoint(s));    // Fluent
-            vars.endFluentIndex[i.numVar] = (int)vars.fluents.size();
-            vars.fluents.push_back(cont->real_const(varName));
-        }
+    for (TFluentInterval& i : p->getNumVarValues(false)) {
+        sprintf(varName, "f%dt%d", i.numVar, stepToEndPoint(s));    // Fluent
+        vars.endFluentIndex[i.numVar] = (int)vars.fluents.size();
+        vars.fluents.push_back(cont->real_const(varName));
     }
 }
 
@@ -115,21 +179,19 @@ void Z3Checker::defineConstraints(Plan* p, TStep s)
         }
     }
 
-    if (p->holdCondEff != nullptr) {
-        for (unsigned int numEff : *p->holdCondEff) {
-            SASConditionalEffect& e = a->conditionalEff[numEff];
-            for (SASNumericCondition& c : e.startNumCond) {
-                defineNumericContraint(c, start);
-            }
-            for (SASNumericCondition& c : e.endNumCond) {
-                defineNumericContraint(c, end);
-            }
-            for (SASNumericEffect& c : e.startNumEff) {
-                defineNumericEffect(c, start);
-            }
-            for (SASNumericEffect& c : e.endNumEff) {
-                defineNumericEffect(c, end);
-            }
+    for (unsigned int numEff : p->getConditionalEffects()) {
+        SASConditionalEffect& e = a->conditionalEff[numEff];
+        for (SASNumericCondition& c : e.startNumCond) {
+            defineNumericContraint(c, start);
+        }
+        for (SASNumericCondition& c : e.endNumCond) {
+            defineNumericContraint(c, end);
+        }
+        for (SASNumericEffect& c : e.startNumEff) {
+            defineNumericEffect(c, start);
+        }
+        for (SASNumericEffect& c : e.endNumEff) {
+            defineNumericEffect(c, end);
         }
     }
 
@@ -151,7 +213,7 @@ void Z3Checker::defineConstraints(Plan* p, TStep s)
         add(10 * getPointVar(end) > 10 * getPointVar(start) + intDur - 5);
     }
 
-    for (TOrdering o : p->orderings) {      // Orderings
+    for (TOrdering o : p->getOrderings()) {      // Orderings
         TTimePoint tp1 = firstPoint(o), tp2 = secondPoint(o);
         if (tp1 + 1 != tp2 || (tp1 & 1) == 1)
             add(getPointVar(tp1) < getPointVar(tp2));
@@ -176,20 +238,20 @@ expr& Z3Checker::getControlVar(int var, TStep s)
 expr& Z3Checker::getProductorVar(TVariable var, TTimePoint tp)
 {
     TStep s = timePointToStep(tp);
-    Plan* p = planComponents.get(s);
+    Plan* p = planComponents->get(s);
     if ((tp & 1) == 1) { // End point
-        for (TNumericCausalLink& cl : p->endPoint.numCausalLinks) {
+        for (TNumericCausalLink& cl : p->getNumericCausalLinks(false)) {
             if (cl.var == var) {
                 return getFluent(cl.var, cl.timePoint);
             }
         }
     }
-    for (TNumericCausalLink& cl : p->startPoint.numCausalLinks) {
+    for (TNumericCausalLink& cl : p->getNumericCausalLinks(true)) {
         if (cl.var == var) {
             return getFluent(cl.var, cl.timePoint);
         }
     }
-    for (TNumericCausalLink& cl : p->endPoint.numCausalLinks) {
+    for (TNumericCausalLink& cl : p->getNumericCausalLinks(false)) {
         if (cl.var == var) {
             return getFluent(cl.var, cl.timePoint);
         }
@@ -321,7 +383,7 @@ void Z3Checker::showModel(model m)
 void Z3Checker::updatePlan(Plan* p, model m, TControVarValues* cvarValues)
 {
     TTimePoint tp = 0;
-    for (TStep s = 0; s < planComponents.size(); s++) {
+    for (TStep s = 0; s < planComponents->size(); s++) {
         TTimePoint startPoint = stepToStartPoint(s), endPoint = startPoint + 1;
         //std::cout << m.eval(getPointVar(tp)).as_int64() << std::endl;
         //std::cout << m.eval(getPointVar(tp + 1)).as_int64() << std::endl;
@@ -329,8 +391,8 @@ void Z3Checker::updatePlan(Plan* p, model m, TControVarValues* cvarValues)
         TFloatValue endTime = round3d(m.eval(getPointVar(tp++)).as_int64() / 1000.0f);
         //std::cout << "Time point " << stepToStartPoint(s) << ": " << startTime << std::endl;
         //std::cout << "Time point " << stepToEndPoint(s) << ": " << endTime << std::endl;
-        Plan* pc = planComponents.get(s);
-        if (cvarValues != nullptr && pc->cvarValues != nullptr) {
+        Plan* pc = planComponents->get(s);
+        if (cvarValues != nullptr && !pc->getControlVarValues().empty()) {
             std::vector<float> valuesList;
             for (int cv = 0; cv < pc->action->controlVars.size(); cv++)
                 valuesList.push_back(m.eval(getControlVar(cv, s)).as_double());
@@ -340,27 +402,26 @@ void Z3Checker::updatePlan(Plan* p, model m, TControVarValues* cvarValues)
             p->setTime(startTime, endTime, p->fixedInit);
         }
         else {
-            if (abs(startTime - pc->startPoint.updatedTime) > EPSILON / 2) {
+            if (abs(startTime - planComponents->getTime(startPoint)) > EPSILON / 2) {
                 //std::cout << "Time point " << startPoint << ": " << startTime << std::endl;
                 p->addPlanUpdate(startPoint, startTime);
             }
-            if (abs(endTime - pc->endPoint.updatedTime) > EPSILON / 2) {
+            if (abs(endTime - planComponents->getTime(endPoint)) > EPSILON / 2) {
                 //std::cout << "Time point " << endPoint << ": " << endTime << std::endl;
                 p->addPlanUpdate(endPoint, endTime);
             }
         }
-        //updateFluentValues(pc->startPoint.numVarValues, startPoint, m);
-        //updateFluentValues(pc->startPoint.numVarValues, endPoint, m);
+        //updateFluentValues(pc->getNumVarValues(true), startPoint, m);
+        //updateFluentValues(pc->getNumVarValues(false), endPoint, m);
     }
+    p->timesVersion++;      // The cached components that include this plan must be recalculated
     //showModel(checker->get_model());
 }
 
-void Z3Checker::updateFluentValues(std::vector<TFluentInterval>* numValues, TTimePoint tp, model& m)
+void Z3Checker::updateFluentValues(PlanArray<TFluentInterval> numValues, TTimePoint tp, model& m)
 {
-    if (numValues == nullptr) return;
-    for (int i = 0; i < numValues->size(); i++) {
-        TFluentInterval* f = &(numValues->at(i));
-        TFloatValue value = (TFloatValue)m.eval(getFluent(f->numVar, tp)).as_double();
-        f->interval.minValue = f->interval.maxValue = value;
+    for (TFluentInterval& f : numValues) {
+        TFloatValue value = (TFloatValue)m.eval(getFluent(f.numVar, tp)).as_double();
+        f.interval.minValue = f.interval.maxValue = value;
     }
 }
@@ -5,6 +5,7 @@
 #include <unordered_map>
 #include "plan.h"
 #include "planComponents.h"
+#include "planValidator.h"
 #include "z3++.h"
 using namespace z3;
 
@@ -12,7 +13,14 @@ using namespace z3;
 /* Oscar Sapena Vercher - DSIC - UPV                    */
 /* April 2022                                           */
 /********************************************************/
-/* Plan validity checking through Z3 solver.            */
+/* Plan validity checking through Z3 solver. The        */
+/* context and the solver are kept between checks: the  */
+/* variables and constraints of each plan component are */
+/* added in a new solver scope, so checking a plan that */
+/* shares its first steps with the previous one only    */
+/* pops the unshared steps and pushes the new ones.     */
+/* Plans are first checked without Z3 by the validator, */
+/* so the solver is only used when it cannot decide.    */
 /********************************************************/
 
 typedef std::unordered_map<TStep, std::vector<float> > TControVarValues;
@@ -32,12 +40,19 @@ public:
 class Z3Checker {
 private:
 	bool optimizeMakespan;
-	PlanComponents planComponents;
+	PlanComponents* planComponents;		// Components of the plan (shared with the search thread, if given)
+	PlanComponents localComponents;
+	PlanValidator validator;			// Fast check without Z3
 	std::vector<Z3StepVariables> stepVars;
+	std::vector<Plan*> levels;			// Plan components whose constraints are in the solver (one scope each)
+	std::vector<TPlanId> levelIds;		// Ids of those components (to detect reused memory)
 	context* cont;
 	solver* checker;
 	optimize* optimizer;
 
+	void reset();
+	bool incrementalCheck(Plan* p, TControVarValues* cvarValues);
+	bool optimizePlan(Plan* p, TControVarValues* cvarValues);
 	void defineVariables(Plan* p, TStep s);
 	void defineConstraints(Plan* p, TStep s);
 	expr& getDurationVar(TStep s);
@@ -53,9 +68,12 @@ private:
 	void defineNumericEffect(SASNumericEffect& e, TTimePoint tp);
 	//void showModel(model m);
 	void updatePlan(Plan* p, model m, TControVarValues* cvarValues);
-	void updateFluentValues(std::vector<TFluentInterval>* numValues, TTimePoint tp, model& m);
+	void updateFluentValues(PlanArray<TFluentInterval> numValues, TTimePoint tp, model& m);
 
 public:
+	Z3Checker() : Z3Checker(nullptr) { }
+	Z3Checker(PlanComponents* planComponents);
+	~Z3Checker();
 	bool checkPlan(Plan* p, bool optimizeMakespan, TControVarValues* cvarValues = nullptr);
 };
 
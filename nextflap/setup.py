@@ -8,14 +8,18 @@ FILES = [('', 'nextflap.cpp'), ('parser', 'parser.cpp'), ('parser', 'syntaxAnaly
          ('parser', 'parsedTask.cpp'), ('preprocess', 'preprocess.cpp'),
          ('preprocess', 'preprocessedTask.cpp'), ('grounder', 'grounder.cpp'),
          ('grounder', 'groundedTask.cpp'), ('heuristics', 'evaluator.cpp'),
-         ('heuristics', 'hFF.cpp'), ('heuristics', 'hLand.cpp'), ('heuristics', 'landmarks.cpp'),
-         ('heuristics', 'numericRPG.cpp'), ('heuristics', 'rpg.cpp'), ('heuristics', 'temporalRPG.cpp'),
-         ('planner', 'intervalCalculations.cpp'), ('planner', 'linearizer.cpp'), ('planner', 'plan.cpp'),
+         ('heuristics', 'hFF.cpp'), ('heuristics', 'heuristicCache.cpp'), ('heuristics', 'hLand.cpp'),
+         ('heuristics', 'landmarks.cpp'),
+         ('heuristics', 'numericRPG.cpp'), ('heuristics', 'preconditionCounter.cpp'), ('heuristics', 'rpg.cpp'),
+         ('heuristics', 'temporalRPG.cpp'), ('planner', 'distributedPlanner.cpp'),
+         ('planner', 'intervalCalculations.cpp'),
+         ('planner', 'linearizer.cpp'), ('planner', 'orderMatrix.cpp'), ('planner', 'plan.cpp'),
          ('planner', 'planBuilder.cpp'), ('planner', 'planComponents.cpp'), ('planner', 'planEffects.cpp'),
-         ('planner', 'planner.cpp'), ('planner', 'plannerSetting.cpp'), ('planner', 'printPlan.cpp'),
-         ('planner', 'selector.cpp'), ('planner', 'state.cpp'), ('planner', 'successors.cpp'),
+         ('planner', 'planner.cpp'), ('planner', 'plannerSetting.cpp'), ('planner', 'planValidator.cpp'),
+         ('planner', 'printPlan.cpp'), ('planner', 'selector.cpp'), ('planner', 'state.cpp'),
+         ('planner', 'stateRegistry.cpp'), ('planner', 'successors.cpp'), ('planner', 'temporalNetwork.cpp'),
          ('planner', 'z3Checker.cpp'), ('sas', 'mutexGraph.cpp'), ('sas', 'sasTask.cpp'),
-         ('sas', 'sasTranslator.cpp'), ('utils', 'utils.cpp'), ('', 'up_nextflap.py')]
+         ('sas', 'sasTranslator.cpp'), ('utils', 'utils.cpp'), ('utils', 'arena.cpp'), ('', 'up_nextflap.py')]
 
 def error(msg):
     raise Exception(msg)
@@ -100,7 +104,7 @@ def compilePlanner():
     z3IncludeFolder, z3LibFolder = getZ3Folder()
     platform = getPlatform()
     z3Lib = getZ3Library(z3LibFolder, platform)
-    CFLAGS = f'-c -Wall -std=c++20 -O3 -Wextra -pedantic -fPIC -I{z3IncludeFolder} -I{pythonFolder} -I{pybindFolder}'
+    CFLAGS = f'-c -Wall -std=c++20 -O3 -Wextra -pedantic -fPIC -pthread -I{z3IncludeFolder} -I{pythonFolder} -I{pybindFolder}'
     print('Compiling...')
     for folder, file in FILES:
         if file.endswith('.cpp'):
@@ -121,7 +125,7 @@ def compilePlanner():
                 print(process.stderr.decode('UTF-8'))
                 error(f'could not compile {params[-1]}')
     print('Linking...')
-    params = ['g++', '-shared', '-lm']
+    params = ['g++', '-shared', '-lm', '-pthread']
     if platform == 'linux':
         pvars = get_config_vars()
         params.append("-Wl,-rpath,$$ORIGIN")
@@ -0,0 +1,160 @@
+#include "arena.h"
+#include <atomic>
+#include <mutex>
+#include <cstdlib>
+
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Memory arena for the search nodes. Each thread       */
+/* allocates from its own chunks (bump allocator with   */
+/* free lists per size class) and all the memory is     */
+/* released at once when the search finishes.           */
+/********************************************************/
+
+using namespace std;
+
+static mutex arenaMutex;									// Protects the list of arenas and the large blocks
+static vector<Arena*>* arenas = new vector<Arena*>();		// Arenas of all threads (never destroyed, as threads can outlive it)
+static atomic<unsigned int> arenaEpoch(1);					// Generation, increased each time the memory is released
+static thread_local Arena* threadArena = nullptr;
+static thread_local unsigned int threadArenaEpoch = 0;
+
+// Header list of large blocks
+static void* largeBlocks = nullptr;
+
+Arena::Arena()
+{
+	current = end = nullptr;
+	for (unsigned int i = 0; i < ARENA_NUM_CLASSES; i++)
+		freeLists[i] = nullptr;
+}
+
+Arena::~Arena()
+{
+	for (char* c : chunks)
+		free(c);
+}
+
+// Returns the arena of the current thread. A new one is created after a bulk release
+Arena* Arena::local()
+{
+	unsigned int epoch = arenaEpoch.load(memory_order_acquire);
+	if (threadArena == nullptr || threadArenaEpoch != epoch) {
+		lock_guard<mutex> lock(arenaMutex);
+		threadArena = new Arena();
+		threadArenaEpoch = epoch;
+		arenas->push_back(threadArena);
+	}
+	return threadArena;
+}
+
+// Takes a block of the given size class from its free list or from the current chunk
+void* Arena::allocateSmall(unsigned int sizeClass)
+{
+	FreeBlock* b = freeLists[sizeClass];
+	if (b != nullptr) {
+		freeLists[sizeClass] = b->next;
+		return b;
+	}
+	size_t size = getClassSize(sizeClass);
+	if (current + size > end) {
+		char* chunk = (char*)malloc(ARENA_CHUNK_SIZE);
+		if (chunk == nullptr) throw bad_alloc();
+		chunks.push_back(chunk);
+		current = chunk;
+		end = chunk + ARENA_CHUNK_SIZE;
+	}
+	void* res = current;
+	current += size;
+	return res;
+}
+
+// Large blocks are kept in a shared list, so they can be released in bulk too
+void* Arena::allocateLarge(size_t size)
+{
+	LargeBlock* b = (LargeBlock*)malloc(sizeof(LargeBlock) + size);
+	if (b == nullptr) throw bad_alloc();
+	b->size = size;
+	b->prev = nullptr;
+	lock_guard<mutex> lock(arenaMutex);
+	b->next = (LargeBlock*)largeBlocks;
+	if (b->next != nullptr) b->next->prev = b;
+	largeBlocks = b;
+	return b + 1;
+}
+
+void Arena::deallocateLarge(void* p)
+{
+	LargeBlock* b = ((LargeBlock*)p) - 1;
+	{
+		lock_guard<mutex> lock(arenaMutex);
+		if (b->prev != nullptr) b->prev->next = b->next;
+		else largeBlocks = b->next;
+		if (b->next != nullptr) b->next->prev = b->prev;
+	}
+	free(b);
+}
+
+// Allocates a memory block in the arena of the current thread
+void* Arena::allocate(size_t size)
+{
+	if (size > ARENA_MAX_SMALL_SIZE) return allocateLarge(size);
+	return local()->allocateSmall(getSizeClass(size));
+}
+
+// Returns a block to the free list of the current thread. Blocks can be freed by a thread different from the
+// one that allocated them, as all the arenas are released at the same time. The blocks allocated in a
+// generation that has been released are ignored, as their memory is no longer owned by the arenas
+void Arena::deallocate(void* p, size_t size, unsigned int generation)
+{
+	if (p == nullptr || generation != arenaEpoch.load(memory_order_acquire)) return;
+	if (size > ARENA_MAX_SMALL_SIZE) {
+		deallocateLarge(p);
+		return;
+	}
+	Arena* a = local();
+	unsigned int sizeClass = getSizeClass(size);
+	FreeBlock* b = (FreeBlock*)p;
+	b->next = a->freeLists[sizeClass];
+	a->freeLists[sizeClass] = b;
+}
+
+// Releases the memory of all threads. The blocks allocated before cannot be used anymore
+void Arena::releaseAll()
+{
+	lock_guard<mutex> lock(arenaMutex);
+	for (Arena* a : *arenas)
+		delete a;
+	arenas->clear();
+	LargeBlock* b = (LargeBlock*)largeBlocks;
+	while (b != nullptr) {
+		LargeBlock* next = b->next;
+		free(b);
+		b = next;
+	}
+	largeBlocks = nullptr;
+	arenaEpoch.fetch_add(1, memory_order_acq_rel);
+}
+
+// Returns the current generation of the arenas. It changes after each bulk release
+unsigned int Arena::getGeneration()
+{
+	return arenaEpoch.load(memory_order_acquire);
+}
+
+// Returns the memory currently reserved by the arenas (in bytes)
+size_t Arena::reservedMemory()
+{
+	lock_guard<mutex> lock(arenaMutex);
+	size_t total = 0;
+	for (Arena* a : *arenas)
+		total += a->chunks.size() * (size_t)ARENA_CHUNK_SIZE;
+	LargeBlock* b = (LargeBlock*)largeBlocks;
+	while (b != nullptr) {
+		total += b->size;
+		b = b->next;
+	}
+	return total;
+}
@@ -0,0 +1,119 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Memory arena for the search nodes. Each thread       */
+/* allocates from its own chunks (bump allocator with   */
+/* free lists per size class) and all the memory is     */
+/* released at once when the search finishes. Each bulk */
+/* release starts a new generation: the owners of the   */
+/* blocks keep the generation in which they allocated   */
+/* them, so the blocks of a released generation are not */
+/* returned to the free lists.                          */
+/********************************************************/
+
+#include <cstddef>
+#include <vector>
+#include <new>
+#include <utility>
+
+#define ARENA_CHUNK_SIZE		1048576		// Size of the memory chunks requested to the system
+#define ARENA_NUM_CLASSES		21			// 16 classes of 16 bytes (up to 256) + 5 power-of-two classes (up to 8192)
+#define ARENA_MAX_SMALL_SIZE	8192		// Larger blocks are requested to the system, but also released in bulk
+
+class Arena {
+private:
+	class FreeBlock {
+	public:
+		FreeBlock* next;
+	};
+
+	class LargeBlock {		// Header of the large blocks
+	public:
+		LargeBlock* prev;
+		LargeBlock* next;
+		size_t size;
+		size_t padding;
+	};
+
+	std::vector<char*> chunks;
+	char* current;							// First free byte in the last chunk
+	char* end;
+	FreeBlock* freeLists[ARENA_NUM_CLASSES];
+
+	Arena();
+	~Arena();
+	void* allocateSmall(unsigned int sizeClass);
+	static Arena* local();
+	static void* allocateLarge(size_t size);
+	static void deallocateLarge(void* p);
+
+	static inline unsigned int getSizeClass(size_t size) {
+		if (size <= 256) return size == 0 ? 0 : (unsigned int)((size - 1) >> 4);
+		unsigned int c = 16;
+		size_t classSize = 512;
+		while (classSize < size) {
+			classSize <<= 1;
+			c++;
+		}
+		return c;
+	}
+	static inline size_t getClassSize(unsigned int sizeClass) {
+		if (sizeClass < 16) return ((size_t)sizeClass + 1) << 4;
+		return ((size_t)512) << (sizeClass - 16);
+	}
+
+public:
+	static void* allocate(size_t size);
+	static void deallocate(void* p, size_t size) { deallocate(p, size, getGeneration()); }
+	static void deallocate(void* p, size_t size, unsigned int generation);	// Ignored if the generation was released
+	static void releaseAll();				// No thread can be using the memory of the arenas, and the objects stored
+											// in them must be destroyed before (only outside owners can be freed later)
+	static unsigned int getGeneration();
+	static size_t reservedMemory();
+};
+
+// STL allocator that takes the memory from the arena of the current thread. The memory of a container
+// created before a bulk release is not returned to the arena
+template <typename T>
+class ArenaAllocator {
+public:
+	using value_type = T;
+	unsigned int generation;
+
+	ArenaAllocator() noexcept { generation = Arena::getGeneration(); }
+	template <typename U> ArenaAllocator(const ArenaAllocator<U>& other) noexcept { generation = other.generation; }
+	T* allocate(size_t n) { return (T*)Arena::allocate(n * sizeof(T)); }
+	void deallocate(T* p, size_t n) noexcept { Arena::deallocate(p, n * sizeof(T), generation); }
+	template <typename U> bool operator==(const ArenaAllocator<U>& other) const noexcept { return generation == other.generation; }
+	template <typename U> bool operator!=(const ArenaAllocator<U>& other) const noexcept { return generation != other.generation; }
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T> >;
+
+// Creates an object in the arena
+template <typename T, typename... Args>
+inline T* arenaNew(Args&&... args) {
+	return new (Arena::allocate(sizeof(T))) T(std::forward<Args>(args)...);
+}
+
+// Destroys an object created with arenaNew in the given generation
+template <typename T>
+inline void arenaDelete(T* p, unsigned int generation) {
+	if (p != nullptr && generation == Arena::getGeneration()) {
+		p->~T();
+		Arena::deallocate(p, sizeof(T), generation);
+	}
+}
+
+// Destroys an object created with arenaNew in the current generation
+template <typename T>
+inline void arenaDelete(T* p) {
+	arenaDelete(p, Arena::getGeneration());
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Lock-free multiple-producer single-consumer queue.   */
+/* Any thread can push, but only the owner can pop.     */
+/********************************************************/
+
+#include <atomic>
+
+template <typename T>
+class MPSCQueue {
+private:
+	class Node {
+	public:
+		std::atomic<Node*> next;
+		T value;
+		Node() : next(nullptr), value() { }
+		Node(const T& v) : next(nullptr), value(v) { }
+	};
+
+	std::atomic<Node*> head;	// Last pushed node (producers side)
+	Node* tail;					// Dummy node before the first element (consumer side)
+
+public:
+	MPSCQueue() {
+		tail = new Node();
+		head.store(tail, std::memory_order_relaxed);
+	}
+
+	~MPSCQueue() {
+		while (tail != nullptr) {
+			Node* next = tail->next.load(std::memory_order_relaxed);
+			delete tail;
+			tail = next;
+		}
+	}
+
+	MPSCQueue(const MPSCQueue&) = delete;
+	MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+	// Adds an element. It can be called from any thread
+	void push(const T& v) {
+		Node* n = new Node(v);
+		Node* prev = head.exchange(n, std::memory_order_acq_rel);
+		prev->next.store(n, std::memory_order_release);
+	}
+
+	// Removes the first element. Returns false if the queue is empty (or a push is still in progress).
+	// It can only be called from the consumer thread
+	bool pop(T& v) {
+		Node* next = tail->next.load(std::memory_order_acquire);
+		if (next == nullptr) return false;
+		v = next->value;
+		delete tail;
+		tail = next;
+		return true;
+	}
+};
+
+#endif
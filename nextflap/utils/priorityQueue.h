@@ -5,94 +5,83 @@
 /* Oscar Sapena Vercher - DSIC - UPV                    */
 /* April 2022                                           */
 /********************************************************/
-/* Priority queue implementation.                       */
+/* Priority queue implementation. The items are stored  */
+/* by value in a binary heap, so no memory is allocated */
+/* per item. The queue can be cleared and reused.       */
 /********************************************************/
 
 #include <vector>
+#include <functional>
 
 #define DEFAULT_PQ_CAPACITY	 250
 
-class PriorityQueueItem {
-public:
-	virtual int compare(PriorityQueueItem* other) = 0;
-	virtual ~PriorityQueueItem() { }
-};
-
+// Compare(a, b) returns true if item a must be polled before item b
+template <typename T, typename Compare = std::less<T>>
 class PriorityQueue {
 private:
-	std::vector<PriorityQueueItem*> pq;		// Priority queue
+	std::vector<T> pq;		// Heap (the root is at position 0)
+	Compare before;
 
+	// Moves down the item at the given position (1-based)
 	void heapify(unsigned int gap) {
-		PriorityQueueItem* aux = pq[gap];
-		unsigned int child = gap << 1;
-		while (child < pq.size()) {
-			if (child != pq.size() - 1 && pq[child + 1]->compare(pq[child]) < 0)
+		T aux = std::move(pq[gap - 1]);
+		unsigned int n = (unsigned int)pq.size(), child = gap << 1;
+		while (child <= n) {
+			if (child != n && before(pq[child], pq[child - 1]))
 				child++;
-			if (pq[child]->compare(aux) < 0) {
-				pq[gap] = pq[child];
+			if (before(pq[child - 1], aux)) {
+				pq[gap - 1] = std::move(pq[child - 1]);
 				gap = child;
 				child = gap << 1;
 			}
 			else break;
 		}
-		pq[gap] = aux;
+		pq[gap - 1] = std::move(aux);
 	}
 
 public:
-	
 	PriorityQueue() : PriorityQueue(DEFAULT_PQ_CAPACITY) { }
 
 	PriorityQueue(unsigned int initialCapacity) {
 		pq.reserve(initialCapacity);
-		pq.push_back(nullptr);	// Position 0 empty
 	}
 
-	void add(PriorityQueueItem* p) {
-		unsigned int gap = (unsigned int)pq.size();
-		pq.push_back(nullptr);
-		while (gap > 1 && p->compare(pq[gap >> 1]) < 0) {
-			pq[gap] = pq[gap >> 1];
+	void add(const T& item) {
+		unsigned int gap = (unsigned int)pq.size() + 1;
+		pq.push_back(item);
+		while (gap > 1 && before(item, pq[(gap >> 1) - 1])) {
+			pq[gap - 1] = std::move(pq[(gap >> 1) - 1]);
 			gap = gap >> 1;
 		}
-		pq[gap] = p;
+		pq[gap - 1] = item;
 	}
-	
+
+	template <typename... Args>
+	inline void emplace(Args&&... args) {
+		add(T(std::forward<Args>(args)...));
+	}
+
 	inline int size() {
-		return (int)pq.size() - 1;
+		return (int)pq.size();
 	}
-	
-	inline PriorityQueueItem* peek() {
-		return pq[1];
+
+	inline T& peek() {
+		return pq[0];
 	}
-	
-	PriorityQueueItem* poll() {
-		PriorityQueueItem* next = pq[1];
-		if (pq.size() > 2) {
-			pq[1] = pq.back();
+
+	T poll() {
+		T next = std::move(pq[0]);
+		if (pq.size() > 1) {
+			pq[0] = std::move(pq.back());
 			pq.pop_back();
 			heapify(1);
 		}
-		else if (pq.size() > 1) pq.pop_back();
+		else pq.pop_back();
 		return next;
 	}
 
-	inline void clear() {
+	inline void clear() {	// The storage is kept
 		pq.clear();
-		pq.push_back(nullptr);	// Position 0 empty
-	}
-
-	inline PriorityQueueItem* at(unsigned int i) {
-		return pq[i];
-	}
-
-	void fix() {
-		for (unsigned int i = (unsigned int)pq.size() / 2; i > 0; i--)
-			heapify(i);
-	}
-
-	void fastRemove(unsigned int i) {
-		pq[i] = pq.back();
-		pq.pop_back();
 	}
 };
 
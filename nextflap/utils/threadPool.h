@@ -0,0 +1,102 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+/********************************************************/
+/* Oscar Sapena Vercher - DSIC - UPV                    */
+/* April 2022                                           */
+/********************************************************/
+/* Pool of persistent threads to run a task in parallel */
+/* The calling thread also takes part as worker 0.      */
+/********************************************************/
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+class ThreadPool {
+private:
+	std::vector<std::thread> threads;
+	std::mutex mtx;
+	std::condition_variable startCond;
+	std::condition_variable endCond;
+	std::function<void(unsigned int)> task;
+	std::exception_ptr error;
+	unsigned int generation;	// Number of tasks launched
+	unsigned int pending;		// Number of pool threads still running the current task
+	bool finish;
+
+	void workerLoop(unsigned int index) {
+		unsigned int lastGeneration = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mtx);
+				startCond.wait(lock, [&] { return finish || generation != lastGeneration; });
+				if (finish) return;
+				lastGeneration = generation;
+			}
+			std::exception_ptr e = nullptr;
+			try {
+				task(index);
+			}
+			catch (...) {
+				e = std::current_exception();
+			}
+			std::lock_guard<std::mutex> lock(mtx);
+			if (e != nullptr && error == nullptr) error = e;
+			if (--pending == 0) endCond.notify_one();
+		}
+	}
+
+public:
+	ThreadPool(unsigned int numThreads) {	// numThreads includes the calling thread
+		generation = 0;
+		pending = 0;
+		finish = false;
+		for (unsigned int i = 1; i < numThreads; i++)
+			threads.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			finish = true;
+		}
+		startCond.notify_all();
+		for (std::thread& t : threads)
+			t.join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	inline unsigned int size() { return (unsigned int)threads.size() + 1; }
+
+	// Runs f(workerIndex) in every thread and waits until all of them finish
+	void run(const std::function<void(unsigned int)>& f) {
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			task = f;
+			error = nullptr;
+			pending = (unsigned int)threads.size();
+			generation++;
+		}
+		startCond.notify_all();
+		std::exception_ptr e = nullptr;
+		try {
+			f(0);
+		}
+		catch (...) {
+			e = std::current_exception();
+		}
+		std::unique_lock<std::mutex> lock(mtx);
+		endCond.wait(lock, [&] { return pending == 0; });
+		if (e == nullptr) e = error;
+		lock.unlock();
+		if (e != nullptr) std::rethrow_exception(e);
+	}
+};
+
+#endif
@@ -9,8 +9,6 @@
 /* Constants and utilities.								*/
 /********************************************************/
 
-bool SIGNIFICATIVE_LANDMARKS = false;
-
 #ifdef DEBUG_TO_FILE_NOT_CONSOLE
 ofstream* debugFile = nullptr;
 #else
@@ -19,8 +19,6 @@ using namespace std;
 
 //#define DEBUG_TO_FILE_NOT_CONSOLE
 
-extern bool SIGNIFICATIVE_LANDMARKS;
-
 #ifdef DEBUG_TO_FILE_NOT_CONSOLE
 extern ofstream* debugFile;
 #else
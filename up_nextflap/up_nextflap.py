@@ -53,10 +53,28 @@ class NextFLAPImpl(Engine, OneshotPlannerMixin, PlanValidatorMixin):
     """ Implementation of the NextFLAP Engine. """
     
     def __init__(self, **options):
-        """ Engine initialization. No options are required. """
+        """ Engine initialization. The 'threads' option sets the number of parallel search threads (1 by default).
+            If 'distributed' is True, the threads run a hash-distributed search instead of a portfolio.
+            The 'expansion_threads' option sets the number of threads used to compute the successors of each plan.
+            The 'tie_breaking' option ('fifo' or 'lifo') sets the order of the open plans with the same evaluation.
+            If 'multi_queue' is True, the search alternates several open lists (h, landmarks and preferred operators).
+            If 'lazy_evaluation' is True, the plans are evaluated when they are selected for expansion.
+            If 'anytime' is True, the search goes on after the first plan until the timeout, and each improved plan
+            is passed to the callback of the solve method.
+            The 'memory_limit' option sets the memory (in MB) for the search nodes of each search thread. When it is
+            reached, the worst open plans are discarded (0 by default, no limit). It is not supported by the
+            distributed search, so it is ignored (with a warning) if 'distributed' is True and 'threads' > 1. """
         Engine.__init__(self)
         OneshotPlannerMixin.__init__(self)
         PlanValidatorMixin.__init__(self)
+        self._threads = int(options.get('threads', 1))
+        self._distributed = bool(options.get('distributed', False))
+        self._expansion_threads = int(options.get('expansion_threads', 1))
+        self._fifo_tie_breaking = str(options.get('tie_breaking', 'fifo')).lower() != 'lifo'
+        self._multi_queue = bool(options.get('multi_queue', False))
+        self._lazy_evaluation = bool(options.get('lazy_evaluation', False))
+        self._anytime = bool(options.get('anytime', False))
+        self._memory_limit = int(options.get('memory_limit', 0))
 
     @property
     def name(self) -> str:
@@ -567,8 +585,7 @@ class NextFLAPImpl(Engine, OneshotPlannerMixin, PlanValidatorMixin):
         else:
             return NextFLAPImpl._to_pop_plan(plan_str, problem)
     
-    @staticmethod
-    def _search(problem, durativePlan):
+    def _search(self, problem, durativePlan, callback):
         """
         Searches for a plan.
 
@@ -576,12 +593,21 @@ class NextFLAPImpl(Engine, OneshotPlannerMixin, PlanValidatorMixin):
         ----------
         problem : up.model.Problem
             Planning problem.
+        durativePlan : bool
+            Indicates whether the plan is temporal (True) or not (False).
+        callback : Callable
+            Function that receives the intermediate plans in anytime mode (or None).
 
         Returns
         -------
         Plan (or None if no plan was found).
         """
-        planStr = nextflap.solve(durativePlan)
+        planCallback = None
+        if callback is not None and self._anytime:
+            def planCallback(planStr):
+                plan = NextFLAPImpl._to_nextflap_plan(planStr, problem, durativePlan)
+                callback(up.engines.PlanGenerationResult(PlanGenerationResultStatus.INTERMEDIATE, plan, self.name))
+        planStr = nextflap.solve(durativePlan, planCallback)
         if not planStr.startswith('|'):
             return None    
         if (durativePlan):
@@ -598,12 +624,16 @@ class NextFLAPImpl(Engine, OneshotPlannerMixin, PlanValidatorMixin):
         if output_stream is not None:
             warnings.warn('NextFLAP does not support output stream.', UserWarning)
         if timeout is not None:
-            nextflap.start_task(timeout)
+            nextflap.start_task(timeout, self._threads, self._distributed, self._expansion_threads,
+                                 self._fifo_tie_breaking, self._multi_queue,
+                                 self._lazy_evaluation, self._anytime, self._memory_limit)
         else:
-            nextflap.start_task(-1.0)
+            nextflap.start_task(-1.0, self._threads, self._distributed, self._expansion_threads,
+                                 self._fifo_tie_breaking, self._multi_queue,
+                                 self._lazy_evaluation, self._anytime, self._memory_limit)
         ok, durativePlan = self._translate(problem)
         if ok:
-            plan = self._search(problem, durativePlan)
+            plan = self._search(problem, durativePlan, callback)
         else:
             plan = None
         status = PlanGenerationResultStatus.UNSOLVABLE_INCOMPLETELY if plan is None else PlanGenerationResultStatus.SOLVED_SATISFICING